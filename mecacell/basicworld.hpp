@@ -5,10 +5,18 @@
 #include <algorithm>
 #include <map>
 #include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
 #include "connection.h"
+#include "hierarchicalgrid.hpp"
+#include "integrators.hpp"
 #include "grid.hpp"
 #include "model.h"
 #include "modelconnection.hpp"
+#include "spatialpartition.hpp"
+#include "springbatch.hpp"
+#include "threadpool.hpp"
 
 using namespace std;
 namespace MecaCell {
@@ -25,8 +33,9 @@ protected:
 	// list of cells having commited apoptosis
 	vector<Cell *> cellsToDestroy;
 
-	// hashmap containing cells
-	Grid<Cell *> grid = Grid<Cell *>(5.0 * DEFAULT_CELL_RADIUS);
+	// cells broad phase, rebuilt by all the mechanics workers together (see FlatGrid).
+	// Cells larger than the base cell size go to coarser levels (see HierarchicalGrid)
+	HierarchicalGrid<Cell *> grid = HierarchicalGrid<Cell *>(5.0 * DEFAULT_CELL_RADIUS);
 
 	// model grid containting pair<model_ptr, face_id>
 	Grid<std::pair<Model *, unsigned int>> modelGrid =
@@ -43,10 +52,95 @@ protected:
 	// threshold (dot product) above which we consider two connections to be merged
 	const double MIN_CONNECTION_SIMILARITY = 0.8;
 
+	// cell - model contact tracking: cells already in contact with a model follow their
+	// contacts by walking adjacent faces and only query the model grid again once they
+	// moved more than contactRequeryRatio * radius since their last query
+	double contactRequeryRatio = 0.5;
+	const int MAX_CONTACT_WALK_STEPS = 16;
+	unordered_map<Cell *, Vec> lastModelQueryPosition;
+
+	// adaptive time step: each step is integrated with dt, then rejected (and redone with
+	// a smaller dt) if a cell moved more than maxDisplacementRatio * radius. Steps that
+	// stay well under this bound let dt grow for the next update, within [minDt, maxDt]
+	bool adaptiveDt = false;
+	double minDt = 1.0 / 5000.0;
+	double maxDt = 1.0 / 5.0;
+	double maxDisplacementRatio = 0.05;
+	double dtGrowthFactor = 1.2;
+	double nextDt = dt;
+	vector<double> dtHistory; // accepted dt of each update (adaptive mode only)
+	int nbRejectedSteps = 0;
+	struct CellState {
+		Vec position, prevposition, velocity, angularVelocity;
+		Quaternion orientation;
+	};
+	vector<CellState> savedStates;
+
+	// multi-rate scheduling: each update runs nbMechanicalSubsteps mechanical steps and
+	// then one behavior step, which receives the whole elapsed time. The cell grid (new
+	// cell-cell contacts) and the model collisions are only refreshed every
+	// gridUpdatePeriod and modelCollisionPeriod mechanical steps
+	int nbMechanicalSubsteps = 1;
+	int gridUpdatePeriod = 1;
+	int modelCollisionPeriod = 1;
+	long long nbMechanicalSteps = 0;
+	double behaviorDt = 0; // time elapsed since the last behavior step
+
+	// parallel behavior phase (disabled when behaviorPool is null). Cells are processed
+	// by chunks of behaviorChunkSize; each chunk gathers its daughter cells in its own
+	// buffer and the buffers are merged in chunk order, so the cell order does not
+	// depend on the scheduling. Each chunk reseeds the thread's random engine from
+	// (behaviorSeed, frame, chunk) for the same reason
+	unique_ptr<WorkStealingPool> behaviorPool;
+	size_t behaviorChunkSize = 64;
+	unsigned int behaviorSeed = 0;
+	vector<vector<Cell *>> newCellsBuffers;
+
+	// sleeping cells: a cell whose velocity and force stayed under the thresholds for
+	// sleepDelay consecutive mechanical steps is frozen. Sleeping cells are not
+	// integrated, connections and collisions between sleeping cells are skipped. A cell
+	// wakes up when a moving neighbour pushes it, when it receives a force over the
+	// threshold, on a new contact, when its connections change (growth, division,
+	// neighbour death) or when a model moves
+	bool sleepingEnabled = false;
+	int sleepDelay = 50;
+	double sleepVelocityThreshold = 1e-3;
+	double sleepForceThreshold = 1e-3;
+
+	// parallel mechanics (disabled when mechanicsPool is null): cells and connections are
+	// split in Morton ordered blocks, one per worker, which fills and then always
+	// processes the same block (see SpatialPartition). Only the loops where each element
+	// writes to itself run on the blocks (cell forces, integration, connection geometry,
+	// force reset), so results are identical to the serial version. The partition is
+	// rebuilt when cells or connections are created or destroyed and after a reorder
+	using partition_type = SpatialPartition<Cell, typename Cell::ConnectionType>;
+	unique_ptr<WorkStealingPool> mechanicsPool;
+	partition_type partition;
+	bool partitionValid = false;
+
+	// spatial reordering: every reorderPeriod updates (0 = never), cells and connections
+	// are sorted by the Morton code of their position, so that the force, grid and
+	// collision loops visit neighbours one after the other instead of in birth order
+	int reorderPeriod = 0;
+	vector<pair<uint64_t, Cell *>> cellKeys;
+	vector<pair<uint64_t, typename Cell::ConnectionType *>> connectionKeys;
+
+	// cell-cell connection forces backend (see SpringBatch)
+	ForceBackend forceBackend = ForceBackend::PerConnection;
+	SpringBatch<Cell, typename Cell::ConnectionType> springBatch;
+
+	// cells created by addCells live in contiguous arenas: they are destroyed in place and
+	// an arena is freed once all its cells are gone
+	struct CellArena {
+		Cell *begin;
+		size_t size, alive;
+	};
+	vector<CellArena> cellArenas;
+
 public:
 	using cell_type = Cell;
 	using integrator_type = Integrator;
-	using connect_type = Connection<Cell *>;
+	using connect_type = typename Cell::ConnectionType;
 	using model_type = Model;
 	using modelConnect_type = CellModelConnection<Cell>;
 
@@ -59,9 +153,8 @@ public:
 	// all models are stored in this map, using their name as the key
 	unordered_map<string, Model> models;
 
-	// cells to models connections are stored in a double map model* -> cell*
-	unordered_map<Model *,
-	              unordered_map<Cell *, vector<unique_ptr<CellModelConnection<Cell>>>>>
+	// cells to models connections are stored (by value) in a double map model* -> cell*
+	unordered_map<Model *, unordered_map<Cell *, vector<CellModelConnection<Cell>>>>
 	    cellModelConnections;
 
 	/**********************************************
@@ -69,42 +162,214 @@ public:
 	 *********************************************/
 	Vec getG() const { return g; }
 	void setG(const Vec &v) { g = v; }
-	const Grid<Cell *> &getCellGrid() { return grid; }
+	const HierarchicalGrid<Cell *> &getCellGrid() { return grid; }
+	// base bucket size of the cell grid, best around 5 times the radius of the smallest
+	// cells (larger cells automatically go to coarser levels)
+	void setCellGridCellSize(const double s) {
+		grid = HierarchicalGrid<Cell *>(s);
+		grid.build(cells, mechanicsPool.get());
+	}
 	const Grid<pair<Model *, unsigned int>> &getModelGrid() { return modelGrid; }
 	double getViscosityCoef() const { return viscosityCoef; }
 	void setViscosityCoef(const double d) { viscosityCoef = d; }
+	double getContactRequeryRatio() const { return contactRequeryRatio; }
+	void setContactRequeryRatio(const double r) { contactRequeryRatio = r; }
+	double getDt() const { return dt; }
+	bool isAdaptiveDtEnabled() const { return adaptiveDt; }
+	void enableAdaptiveDt(double minD, double maxD, double maxDispRatio = 0.05) {
+		adaptiveDt = true;
+		minDt = minD;
+		maxDt = maxD;
+		maxDisplacementRatio = maxDispRatio;
+		nextDt = std::min(maxDt, std::max(minDt, dt));
+	}
+	void disableAdaptiveDt() { adaptiveDt = false; }
+	double getMinDt() const { return minDt; }
+	double getMaxDt() const { return maxDt; }
+	double getMaxDisplacementRatio() const { return maxDisplacementRatio; }
+	void setDtGrowthFactor(const double f) { dtGrowthFactor = f; }
+	const vector<double> &getDtHistory() const { return dtHistory; }
+	void clearDtHistory() { dtHistory.clear(); }
+	int getNbRejectedSteps() const { return nbRejectedSteps; }
+	int getNbMechanicalSubsteps() const { return nbMechanicalSubsteps; }
+	void setNbMechanicalSubsteps(const int n) { nbMechanicalSubsteps = std::max(1, n); }
+	int getGridUpdatePeriod() const { return gridUpdatePeriod; }
+	void setGridUpdatePeriod(const int n) { gridUpdatePeriod = std::max(1, n); }
+	int getModelCollisionPeriod() const { return modelCollisionPeriod; }
+	void setModelCollisionPeriod(const int n) { modelCollisionPeriod = std::max(1, n); }
+	long long getNbMechanicalSteps() const { return nbMechanicalSteps; }
+	// behaviors run concurrently when n > 1: updateBehavior must then only modify the
+	// cell itself (dividing, growing and dying are fine)
+	void setNbBehaviorThreads(const size_t n) {
+		if (n > 1)
+			behaviorPool.reset(new WorkStealingPool(n));
+		else
+			behaviorPool.reset();
+	}
+	size_t getNbBehaviorThreads() const { return behaviorPool ? behaviorPool->size() : 1; }
+	void setBehaviorChunkSize(const size_t n) {
+		behaviorChunkSize = std::max<size_t>(1, n);
+	}
+	void setBehaviorSeed(const unsigned int s) { behaviorSeed = s; }
+	// pinning the workers to cores keeps each partition block on the same core (and the
+	// cells later built by addCells on that core's NUMA node)
+	void setNbMechanicsThreads(const size_t n, bool pinThreads = false) {
+		if (n > 1) {
+			mechanicsPool.reset(new WorkStealingPool(n));
+			if (pinThreads) mechanicsPool->pinToCores();
+		} else {
+			mechanicsPool.reset();
+		}
+		partitionValid = false;
+	}
+	size_t getNbMechanicsThreads() const {
+		return mechanicsPool ? mechanicsPool->size() : 1;
+	}
+	const partition_type &getPartition() const { return partition; }
+	ForceBackend getForceBackend() const { return forceBackend; }
+	void setForceBackend(const ForceBackend b) { forceBackend = b; }
+	int getReorderPeriod() const { return reorderPeriod; }
+	void setReorderPeriod(const int n) { reorderPeriod = std::max(0, n); }
+	void enableSleeping(double velocityThreshold, double forceThreshold, int delay = 50) {
+		sleepingEnabled = true;
+		sleepVelocityThreshold = velocityThreshold;
+		sleepForceThreshold = forceThreshold;
+		sleepDelay = delay;
+	}
+	void disableSleeping() {
+		sleepingEnabled = false;
+		for (auto &c : cells) c->wakeUp();
+	}
+	bool isSleepingEnabled() const { return sleepingEnabled; }
+	size_t getNbSleepingCells() const {
+		size_t n = 0;
+		for (const auto &c : cells)
+			if (c->isSleeping()) ++n;
+		return n;
+	}
 
 	/**********************************************
 	 *             MAIN UPDATE ROUTINE            *
 	 *********************************************/
 	void update() {
 		if (cells.size() > 0) {
-			computeForces();
-			updatePositionsAndOrientations();
-			if (cellModelCollisions) {
-				updateModelGrid();
-				checkForCellModellCollisions();
-			}
-			if (cellCellCollisions) {
-				grid.clear();
-				for (const auto &c : cells)
-					grid.insert(c);
-				updateConnectionsLengthAndDirection();
-				cellCollisions();
-				deleteImpossibleConnections();
+			behaviorDt = 0;
+			for (int s = 0; s < nbMechanicalSubsteps; ++s) {
+				mechanicalStep();
+				// forces of the last substep are kept until the stats are updated
+				if (s + 1 < nbMechanicalSubsteps) resetForces();
 			}
 			updateBehavior();
 			destroyCells();
 			updateStats();
 			resetForces();
+			periodicReorder();
 		}
 		++frame;
 	}
 
+	void mechanicalStep() {
+		integrationStep();
+		collisionStep();
+	}
+
+	// forces and integration
+	void integrationStep() {
+		updatePartition();
+		// external forces received since the last step
+		if (sleepingEnabled) wakeUpPushedCells();
+		computeForces();
+		if (adaptiveDt)
+			adaptiveUpdatePositionsAndOrientations();
+		else
+			updatePositionsAndOrientations();
+		behaviorDt += dt;
+		if (sleepingEnabled) updateSleepingStates();
+	}
+
+	// contacts detection and connections update, from the new positions
+	void collisionStep() {
+		if (cellModelCollisions && nbMechanicalSteps % modelCollisionPeriod == 0) {
+			updateModelGrid();
+			checkForCellModellCollisions();
+		}
+		if (cellCellCollisions) {
+			bool refreshGrid = nbMechanicalSteps % gridUpdatePeriod == 0;
+			if (refreshGrid) grid.build(cells, mechanicsPool.get());
+			updatePartition();
+			updateConnectionsLengthAndDirection();
+			if (refreshGrid) cellCollisions();
+			deleteImpossibleConnections();
+		}
+		++nbMechanicalSteps;
+	}
+
 	/**********************************************
 	 *             UPDATE SUBROUTINES             *
 	 *********************************************/
 
+	void periodicReorder() {
+		if (reorderPeriod > 0 && (frame + 1) % reorderPeriod == 0) reorder();
+	}
+
+	// sorts cells and connections (by the middle of their nodes) along a Morton curve.
+	// Equal codes keep their relative order, so the result doesn't depend on addresses
+	void reorder() {
+		MortonEncoder encode = MortonEncoder::fromPositions(cells.begin(), cells.end());
+		cellKeys.resize(cells.size());
+		for (size_t i = 0; i < cells.size(); ++i)
+			cellKeys[i] = make_pair(encode(cells[i]->getPosition()), cells[i]);
+		sortByCode(cellKeys, cells);
+		connectionKeys.resize(connections.size());
+		for (size_t i = 0; i < connections.size(); ++i) {
+			connect_type *c = connections[i];
+			Vec middle = (c->getNode0()->getPosition() + c->getNode1()->getPosition()) * 0.5;
+			connectionKeys[i] = make_pair(encode(middle), c);
+		}
+		sortByCode(connectionKeys, connections);
+		topologyChanged();
+	}
+
+	template <typename T>
+	static void sortByCode(vector<pair<uint64_t, T *>> &keys, vector<T *> &dest) {
+		std::stable_sort(keys.begin(), keys.end(),
+		                 [](const pair<uint64_t, T *> &a, const pair<uint64_t, T *> &b) {
+			                 return a.first < b.first;
+			               });
+		for (size_t i = 0; i < keys.size(); ++i) dest[i] = keys[i].second;
+	}
+
+	// cells or connections were added, deleted or reordered
+	void topologyChanged() {
+		partitionValid = false;
+		springBatch.invalidate();
+	}
+
+	void updatePartition() {
+		if (!mechanicsPool || partitionValid) return;
+		partition.rebuild(cells, connections, *mechanicsPool);
+		partitionValid = true;
+	}
+
+	// runs f on every cell (resp. connection), on the partition blocks when the mechanics
+	// are parallel. f must only modify its argument
+	template <typename F> void forEachCell(const F &f) {
+		if (mechanicsPool && partitionValid)
+			partition.forEachBlock(*mechanicsPool, [&f](typename partition_type::Block &b) {
+				for (auto &c : b.cells) f(c);
+			});
+		else
+			for (auto &c : cells) f(c);
+	}
+	template <typename F> void forEachConnection(const F &f) {
+		if (mechanicsPool && partitionValid)
+			partition.forEachBlock(*mechanicsPool, [&f](typename partition_type::Block &b) {
+				for (auto &c : b.connections) f(c);
+			});
+		else
+			for (auto &c : connections) f(c);
+	}
+
 	/******************************
 	 *           FORCES           *
 	 ******************************/
@@ -115,34 +380,40 @@ public:
 		}
 	}
 
-	void setDt(double d) { dt = d; }
+	void setDt(double d) { dt = nextDt = d; }
 
 	void computeForces() {
 		// connections
-		for (auto &con : connections)
-			con->computeForces(dt);
+		if (forceBackend == ForceBackend::Batch) {
+			springBatch.computeForces(cells, connections, dt, sleepingEnabled);
+		} else {
+			for (auto &con : connections)
+				if (!bothSleeping(con)) con->computeForces(dt);
+		}
 		for (auto &m : cellModelConnections) {
 			// model* -> cell* -> vec<connection>
 			for (auto &c : m.second) {
+				if (c.first->isSleeping()) continue;
 				for (auto &cmc : c.second) {
-					cmc->computeForces(dt);
+					cmc.computeForces(dt);
 				}
 			}
 		}
 
-		for (auto &c : cells) {
+		forEachCell([this](Cell *c) {
+			if (c->isSleeping()) return;
 			// friction
 			c->receiveForce(-6.0 * M_PI * viscosityCoef * c->getRadius() * c->getVelocity());
 			// gravity
 			c->receiveForce(g);
-		}
+		});
 	}
 
 	void resetForces() {
-		for (auto cIt = cells.begin(); cIt < cells.end(); ++cIt) {
-			(*cIt)->resetForce();
-			(*cIt)->resetTorque();
-		}
+		forEachCell([](Cell *c) {
+			c->resetForce();
+			c->resetTorque();
+		});
 	}
 
 	void applyGravity() {
@@ -151,25 +422,98 @@ public:
 	}
 
 	void updateConnectionsLengthAndDirection() {
-		for (auto &c : connections) {
+		forEachConnection([](connect_type *c) {
+			if (bothSleeping(c)) return;
 			double contactSurface =
 			    M_PI *
 			    (pow(c->getSc().length, 2) +
 			     pow((c->getNode0()->getRadius() + c->getNode1()->getRadius()) / 2.0, 2));
-			c->getFlex().first.setCurrentKCoef(contactSurface);
-			c->getFlex().second.setCurrentKCoef(contactSurface);
-			c->getTorsion().first.setCurrentKCoef(contactSurface);
-			c->getTorsion().second.setCurrentKCoef(contactSurface);
+			c->setJointsKCoef(contactSurface);
 			c->updateLengthDirection();
-		}
+		});
 	}
 
 	void updatePositionsAndOrientations() {
-		for (auto cIt = cells.begin(); cIt < cells.end(); ++cIt) {
-			Cell *c = *cIt;
-			updateCellPos(*c, dt);
-			c->markAsNotTested();
+		if (IsCellLocal<Integrator>::value)
+			forEachCell([this](Cell *c) { updateCellPos(*c, dt); });
+		else
+			integrateAll(updateCellPos, cells, connections, dt);
+		forEachCell([](Cell *c) { c->markAsNotTested(); });
+	}
+
+	static bool bothSleeping(connect_type *c) {
+		return c->getNode0()->isSleeping() && c->getNode1()->isSleeping();
+	}
+
+	void wakeUpPushedCells() {
+		for (auto &c : cells)
+			if (c->isSleeping() && c->getForce().length() >= sleepForceThreshold) c->wakeUp();
+	}
+
+	void updateSleepingStates() {
+		// moving cells wake their sleeping neighbours up
+		for (auto &con : connections) {
+			Cell *n0 = con->getNode0(), *n1 = con->getNode1();
+			if (n0->isSleeping() == n1->isSleeping()) continue;
+			Cell *awake = n0->isSleeping() ? n1 : n0;
+			if (awake->getVelocity().length() >= sleepVelocityThreshold)
+				(n0->isSleeping() ? n0 : n1)->wakeUp();
+		}
+		// as well as forces (neighbours, external code) over the threshold
+		wakeUpPushedCells();
+		for (auto &c : cells) {
+			if (c->isSleeping()) continue;
+			bool calm = c->getVelocity().length() < sleepVelocityThreshold &&
+			            c->getForce().length() < sleepForceThreshold;
+			if (c->updateCalmness(calm) >= sleepDelay) {
+				c->sleep();
+				c->resetAngularVelocity();
+			}
+		}
+	}
+
+	// forces have already been computed with the previously accepted dt (the spring
+	// dampings divide the last length variation by it), so only the integration is redone
+	// when a step is rejected
+	void adaptiveUpdatePositionsAndOrientations() {
+		dt = nextDt;
+		savedStates.resize(cells.size());
+		for (size_t i = 0; i < cells.size(); ++i) {
+			const Cell *c = cells[i];
+			savedStates[i] = {c->getPosition(), c->getPrevposition(), c->getVelocity(),
+			                  c->getAngularVelocity(), c->getOrientationQuaternion()};
+		}
+		double ratio = 0;
+		while (true) {
+			updatePositionsAndOrientations();
+			ratio = maxRelativeDisplacement();
+			if (ratio <= maxDisplacementRatio || dt <= minDt) break;
+			// rejected: restore and retry with a dt scaled to reach the target displacement
+			++nbRejectedSteps;
+			for (size_t i = 0; i < cells.size(); ++i) {
+				Cell *c = cells[i];
+				const CellState &st = savedStates[i];
+				c->setPosition(st.position);
+				c->setPrevposition(st.prevposition);
+				c->setVelocity(st.velocity);
+				c->setAngularVelocity(st.angularVelocity);
+				c->setOrientationQuaternion(st.orientation);
+			}
+			dt = std::max(minDt, dt * std::max(0.2, 0.9 * maxDisplacementRatio / ratio));
 		}
+		dtHistory.push_back(dt);
+		double growth =
+		    ratio > 0 ? std::min(dtGrowthFactor, 0.9 * maxDisplacementRatio / ratio)
+		              : dtGrowthFactor;
+		nextDt = std::min(maxDt, std::max(minDt, dt * std::max(1.0, growth)));
+	}
+
+	double maxRelativeDisplacement() const {
+		double res = 0;
+		for (size_t i = 0; i < cells.size(); ++i)
+			res = std::max(res, (cells[i]->getPosition() - savedStates[i].position).length() /
+			                        cells[i]->getRadius());
+		return res;
 	}
 
 	/******************************
@@ -179,19 +523,28 @@ public:
 		models.emplace(name, path);
 		models.at(name).name = name;
 	}
+	// adds a new instance of an already loaded geometry (shared, not copied)
+	void addModel(const string &name, const shared_ptr<const ModelData> &d) {
+		removeModel(name);
+		models.emplace(name, d);
+		models.at(name).name = name;
+	}
+	// adds a copy of a model instance (its geometry is shared, not copied)
+	void addModel(const string &name, const Model &m) {
+		removeModel(name);
+		models.emplace(name, m);
+		models.at(name).name = name;
+	}
 	void removeModel(const string &name) {
 		if (models.count(name)) {
-			models.erase(name);
-		}
-		if (cellModelConnections.count(name)) {
-			cerr << "deleting stuff" << endl;
-			for (auto &c : cellModelConnections.at(name)) {
-				for (auto &conn : c.second) {
-					c.first->removeModelConnection(conn.second.get());
-				}
+			Model *m = &models.at(name);
+			if (cellModelConnections.count(m)) {
+				vector<Cell *> connectedCells;
+				for (auto &c : cellModelConnections.at(m)) connectedCells.push_back(c.first);
+				cellModelConnections.erase(m);
+				for (auto &c : connectedCells) refreshModelConnections(c);
 			}
-			cerr << "ok" << endl;
-			cellModelConnections.erase(name);
+			models.erase(name);
 		}
 		modelGrid.clear();
 		for (auto &m : models) {
@@ -200,8 +553,8 @@ public:
 	}
 
 	void insertInGrid(Model &m) {
-		for (size_t i = 0; i < m.faces.size(); ++i) {
-			auto &f = m.faces[i];
+		for (size_t i = 0; i < m.data->obj.faces.size(); ++i) {
+			auto &f = m.data->obj.faces[i];
 			modelGrid.insert({&m, i}, m.vertices[f.indices[0]], m.vertices[f.indices[1]],
 			                 m.vertices[f.indices[2]]);
 		}
@@ -218,23 +571,108 @@ public:
 			}
 		}
 		if (modelChange) {
+			for (auto &c : cells) c->wakeUp();
 			modelGrid.clear();
+			lastModelQueryPosition.clear();
 			for (auto &m : models) {
 				insertInGrid(m.second);
 			}
 		}
 	}
 
+	// updates an existing cell - model connection with the new projection of the cell
+	void updateModelConnection(Cell *c, CellModelConnection<Cell> &conn, const Vec &projection,
+	                           size_t face, const Vec &currentDirection) {
+		// first, the bounce spring
+		conn.bouncePoint.position = projection;
+		conn.bouncePoint.face = face;
+		// then the anchor. It's just another simple spring that is always at the
+		// same height as the cell (orthogonal to the bounce spring)
+		// it has a restlength of 0 and follows the cell when its length is more
+		// than the cell's radius;
+		if (conn.anchor.length > 0) {
+			// first we keep the anchor at cell height
+			const Vec &anchorDirection = conn.anchor.direction;
+			Vec crossp = currentDirection.cross(currentDirection.cross(anchorDirection));
+			if (crossp.sqlength() > c->getRadius() * 0.02) {
+				crossp.normalize();
+				double projLength = min<double>(
+				    (conn.anchorPoint.position - c->getPosition()).dot(crossp), c->getRadius());
+				conn.anchorPoint.position = c->getPosition() + projLength * crossp;
+			}
+		}
+	}
+
+	// follows the contacts of a cell from their previous face to the closest adjacent one
+	// (greedy walk on the model's adjacency). Returns false if no contact could be tracked
+	// or if the cell moved too much since its last model grid query, in which case the
+	// broad phase must be used.
+	bool trackModelContacts(Cell *c) {
+		auto lastQuery = lastModelQueryPosition.find(c);
+		if (lastQuery == lastModelQueryPosition.end() ||
+		    (c->getPosition() - lastQuery->second).sqlength() >
+		        pow(contactRequeryRatio * c->getRadius(), 2))
+			return false;
+		struct FaceProjection {
+			size_t face;
+			bool inside;
+			double sqdist;
+			Vec position;
+		};
+		bool tracked = false;
+		const Vec &pos = c->getPosition();
+		const double sqr = c->getRadius() * c->getRadius();
+		for (auto &m : cellModelConnections) {
+			auto cellConnections = m.second.find(c);
+			if (cellConnections == m.second.end()) continue;
+			const Model &model = *m.first;
+			auto project = [&](size_t f) {
+				const Triangle &t = model.data->obj.faces[f];
+				pair<bool, Vec> projec =
+				    projectionIntriangle(model.vertices[t.indices[0]], model.vertices[t.indices[1]],
+				                         model.vertices[t.indices[2]], pos);
+				return FaceProjection{f, projec.first, (projec.second - pos).sqlength(),
+				                      projec.second};
+			};
+			vector<size_t> usedFaces;
+			for (auto &conn : cellConnections->second) {
+				FaceProjection best = project(conn.bouncePoint.face);
+				for (int step = 0; step < MAX_CONTACT_WALK_STEPS; ++step) {
+					size_t f = best.face;
+					for (size_t i = 0; i < model.data->getNbAdjacentFaces(f); ++i) {
+						FaceProjection candidate = project(model.data->getAdjacentFace(f, i));
+						if (candidate.inside && (!best.inside || candidate.sqdist < best.sqdist))
+							best = candidate;
+					}
+					if (best.face == f) break;
+				}
+				if (best.inside && best.sqdist < sqr &&
+				    find(usedFaces.begin(), usedFaces.end(), best.face) == usedFaces.end()) {
+					usedFaces.push_back(best.face);
+					conn.dirty = false;
+					tracked = true;
+					updateModelConnection(c, conn, best.position, best.face,
+					                      (best.position - pos).normalized());
+				}
+			}
+		}
+		return tracked;
+	}
+
 	void checkForCellModellCollisions() {
+		vector<Cell *> changedCells; // cells whose contacts were added or removed
 		// first, we set all connections to dirty
 		for (auto &m : cellModelConnections) {
 			for (auto &c : m.second) {
 				for (auto &conn : c.second) {
-					conn->dirty = true;
+					conn.dirty = !c.first->isSleeping();
 				}
 			}
 		}
 		for (auto &c : cells) {
+			if (c->isSleeping()) continue;
+			if (trackModelContacts(c)) continue;
+			lastModelQueryPosition[c] = c->getPosition();
 			// for each cell, we find if a cell - model collision is possible.
 			auto toTest = modelGrid.retrieveUnique(c->getPosition(), c->getRadius());
 			for (const auto &mf : toTest) {
@@ -243,9 +681,10 @@ public:
 				cerr << " potential collision between cell " << c << " and model "
 				     << mf.first->name << endl;
 				// for each pair <model*, faceId> mf potentially colliding with c
-				const Vec &p0 = mf.first->vertices[mf.first->faces[mf.second].indices[0]];
-				const Vec &p1 = mf.first->vertices[mf.first->faces[mf.second].indices[1]];
-				const Vec &p2 = mf.first->vertices[mf.first->faces[mf.second].indices[2]];
+				const Triangle &face = mf.first->data->obj.faces[mf.second];
+				const Vec &p0 = mf.first->vertices[face.indices[0]];
+				const Vec &p1 = mf.first->vertices[face.indices[1]];
+				const Vec &p2 = mf.first->vertices[face.indices[2]];
 				// checking if cell c is in contact with triangle p0, p1, p2
 				pair<bool, Vec> projec = projectionIntriangle(p0, p1, p2, c->getPosition());
 				// projec = {projection inside triangle, projection coordinates}
@@ -267,41 +706,17 @@ public:
 						     << endl;
 						for (auto &otherconn : cellModelConnections[mf.first][c]) {
 							Vec prevDirection =
-							    (otherconn->bounce.getNode0().getPosition() - c->getPrevposition())
-							        .normalized();
+							    (otherconn.bouncePoint.position - c->getPrevposition()).normalized();
 							cerr << " prevDir.dot(currentDir) = " << prevDirection.dot(currentDirection)
 							     << endl;
 							if (prevDirection.dot(currentDirection) > MIN_CONNECTION_SIMILARITY) {
 								alreadyExist = true;
-								cerr << GREEN << " Yep, it's an old connection (" << otherconn.get()
-								     << ")" << endl;
-								otherconn->dirty = false;
+								cerr << GREEN << " Yep, it's an old connection (" << &otherconn << ")"
+								     << endl;
+								otherconn.dirty = false;
 								// case n° 2, we want to update otherconn
-								// first, the bounce spring
-								otherconn->bounce.getNode0().position = projec.second;
-								otherconn->bounce.getNode0().face = mf.second;
-								cerr << " bounce spring updated" << endl;
-								// then the anchor. It's just another simple spring that is always at the
-								// same height as the cell (orthogonal to the bounce spring)
-								// it has a restlength of 0 and follows the cell when its length is more
-								// than the cell's radius;
-								if (otherconn->anchor.getSc().length > 0) {
-									cerr << " putting anchor at cell level" << endl;
-									// first we keep the anchor at cell height
-									const Vec &anchorDirection = otherconn->anchor.getSc().direction;
-									Vec crossp =
-									    currentDirection.cross(currentDirection.cross(anchorDirection));
-									if (crossp.sqlength() > c->getRadius() * 0.02) {
-										crossp.normalize();
-										cerr << " projection axis = " << crossp << endl;
-										double projLength = min(
-										    (otherconn->anchor.getNode0().getPosition() - c->getPosition())
-										        .dot(crossp),
-										    c->getRadius());
-										otherconn->anchor.getNode0().position =
-										    c->getPosition() + projLength * crossp;
-									}
-								}
+								updateModelConnection(c, otherconn, projec.second, mf.second,
+								                      currentDirection);
 								break;
 							}
 						}
@@ -312,24 +727,14 @@ public:
 						double adh = c->getAdhesionWithModel(mf.first->name);
 						double l = mix(MAX_CELL_ADH_LENGTH * c->getRadius(),
 						               MIN_CELL_ADH_LENGTH * c->getRadius(), adh);
-						unique_ptr<CellModelConnection<Cell>> cmc(new CellModelConnection<Cell>(
-						    Connection<SpaceConnectionPoint, Cell *>(
-						        {SpaceConnectionPoint(c->getPosition()), c}, // N0, N1
-						        Spring(100, dampingFromRatio(0.9, c->getMass(), 100),
-						               0)), // anchor
-						    Connection<ModelConnectionPoint, Cell *>(
-						        {ModelConnectionPoint(mf.first, projec.second, mf.second),
-						         c}, // N0, N1
-						        Spring(c->getStiffness(),
-						               dampingFromRatio(c->getDampRatio(), c->getMass(),
-						                                c->getStiffness() * 1.0),
-						               l) // bounce
-						        )));
-						cmc->anchor.tjEnabled = false;
-						// cmc->anchor.getFlex().first.targetUpdateEnabled = false;
-						// cmc->anchor.getFlex().first.target = -currentDirection;
-						c->addModelConnection(cmc.get());
-						cellModelConnections[mf.first][c].push_back(move(cmc));
+						cellModelConnections[mf.first][c].push_back(CellModelConnection<Cell>(
+						    c, ModelConnectionPoint(mf.first, projec.second, mf.second),
+						    Spring(c->getStiffness(),
+						           dampingFromRatio(c->getDampRatio(), c->getMass(),
+						                            c->getStiffness() * 1.0),
+						           l), // bounce
+						    Spring(100, dampingFromRatio(0.9, c->getMass(), 100), 0))); // anchor
+						changedCells.push_back(c);
 					}
 				}
 				cerr << PURPLE << "|___________________________________________|" << NORMAL
@@ -341,9 +746,9 @@ public:
 		for (auto &m : cellModelConnections) {
 			for (auto &c : m.second) {
 				for (auto it = c.second.begin(); it != c.second.end();) {
-					if ((*it)->dirty) {
+					if (it->dirty) {
 						cerr << " deleting dirty connection " << endl;
-						c.first->removeModelConnection(it->get());
+						changedCells.push_back(c.first);
 						it = c.second.erase(it);
 					} else {
 						++it;
@@ -366,15 +771,38 @@ public:
 				++itM;
 			}
 		}
+		std::sort(changedCells.begin(), changedCells.end());
+		changedCells.erase(std::unique(changedCells.begin(), changedCells.end()),
+		                   changedCells.end());
+		for (auto &c : changedCells) refreshModelConnections(c);
+	}
+
+	// cells keep pointers to their model contacts, which are stored by value (and thus
+	// move when their vector grows or shrinks): they are refreshed after each change
+	void refreshModelConnections(Cell *c) {
+		auto &v = c->getRWModelConnections();
+		v.clear();
+		for (auto &m : cellModelConnections) {
+			auto it = m.second.find(c);
+			if (it != m.second.end())
+				for (auto &conn : it->second) v.push_back(&conn);
+		}
 	}
 
 	void cellCollisions() {
 		for (auto &c : cells) {
+			// sleeping cells are only tested by their awake neighbours (they are never
+			// marked as tested)
+			if (c->isSleeping()) continue;
 			vector<Cell *> toTest = grid.retrieve(c);
-			connect_type *s = nullptr;
 			for (const auto &c2 : toTest) {
 				if (!c2->alreadyTested()) {
+					size_t nbConnections = connections.size();
 					c->connection(c2, connections);
+					if (connections.size() > nbConnections) {
+						c2->wakeUp();
+						topologyChanged();
+					}
 				}
 			}
 			c->markAsTested();
@@ -383,6 +811,7 @@ public:
 
 	void deleteImpossibleConnections() {
 		// erase and delete connections longer than their max length
+		size_t nbConnections = connections.size();
 		connections.erase(
 		    remove_if(connections.begin(), connections.end(), [&](connect_type *c) {
 			    double maxL = c->getNode0()->getRadius() + c->getNode1()->getRadius();
@@ -393,6 +822,7 @@ public:
 			    }
 			    return false;
 			  }), connections.end());
+		if (connections.size() < nbConnections) topologyChanged();
 		// for (auto &c : cells) {
 		// deleteOverlapingConnections(c);
 		//}
@@ -450,6 +880,7 @@ public:
 							connections.erase(remove(connections.begin(), connections.end(), c1),
 							                  connections.end());
 							delete c1;
+							topologyChanged();
 						} else if (scal10 > 0 && c1SqLength < c0SqLength &&
 						           (c1SqLength - scal10 * scal10) < r1 * r1 * overlapCoef) {
 							c0It = vec.erase(c0It);
@@ -459,6 +890,7 @@ public:
 							connections.erase(remove(connections.begin(), connections.end(), c0),
 							                  connections.end());
 							deleted = true;
+							topologyChanged();
 							delete c0;
 							break; // we need to exit the inner loop, c0 doesn't exist
 							       // anymore.
@@ -475,15 +907,53 @@ public:
 	}
 
 	void updateBehavior() {
+		if (behaviorPool) {
+			parallelUpdateBehavior();
+			return;
+		}
 		for (size_t i = 0; i < cells.size(); ++i) {
-			addCell(cells[i]->updateBehavior(dt));
+			addCell(cells[i]->updateBehavior(behaviorDt));
+		}
+	}
+
+	// same semantics as the serial version: daughters are appended after the existing
+	// cells and get their own behavior update, as a new wave, in the same update
+	void parallelUpdateBehavior() {
+		size_t begin = 0;
+		while (begin < cells.size()) {
+			const size_t end = cells.size();
+			const size_t nbChunks = (end - begin + behaviorChunkSize - 1) / behaviorChunkSize;
+			newCellsBuffers.resize(nbChunks);
+			for (size_t ch = 0; ch < nbChunks; ++ch) {
+				behaviorPool->submit([this, ch, begin, end]() {
+					std::seed_seq seq{behaviorSeed, static_cast<unsigned int>(frame),
+					                  static_cast<unsigned int>(begin + ch)};
+					globalRand.seed(seq);
+					Cell::setDeferConnectionUpdates(true);
+					vector<Cell *> &buffer = newCellsBuffers[ch];
+					buffer.clear();
+					size_t last = std::min(end, begin + (ch + 1) * behaviorChunkSize);
+					for (size_t i = begin + ch * behaviorChunkSize; i < last; ++i) {
+						Cell *c = cells[i]->updateBehavior(behaviorDt);
+						if (c) buffer.push_back(c);
+					}
+					Cell::setDeferConnectionUpdates(false);
+				});
+			}
+			behaviorPool->waitAll();
+			for (size_t ch = 0; ch < nbChunks; ++ch)
+				for (auto &c : newCellsBuffers[ch]) addCell(c);
+			// deferred connection updates, now that every radius is known
+			for (size_t i = begin; i < end; ++i)
+				if (cells[i]->hasPendingConnectionUpdate()) cells[i]->updateAllConnections();
+			begin = end;
 		}
 	}
 
 	~BasicWorld() {
 		destroyCells();
 		while (!cells.empty())
-			delete cells.back(), cells.pop_back();
+			deleteCell(cells.back()), cells.pop_back();
 		while (!connections.empty())
 			delete connections.back(), connections.pop_back();
 	}
@@ -493,13 +963,123 @@ public:
 	int getNbUpdates() const { return frame; }
 
 	void addCell(Cell *c) {
-		if (c != NULL) cells.push_back(c);
+		if (c != NULL) {
+			cells.push_back(c);
+			topologyChanged();
+		}
+	}
+
+	// bulk insertion: builds positions.size() cells (with Cell(position), and the given
+	// radii if any) in one contiguous block and connects the ones in contact. Contacts are
+	// searched in parallel on the mechanics pool, when there is one, and created in the
+	// order cellCollisions would create them. Contacts with previously added cells are
+	// left to the next collision step. Returns the first of the new cells, which are also
+	// the last ones of the cells vector.
+	// The cells are laid out in the Morton order of their positions. With a mechanics
+	// pool, the block is cut in slices like the partition would cut these cells and each
+	// slice is built, and connected, by the worker of the matching partition block. Their
+	// memory is thus first touched by that worker, which keeps it on its NUMA node when the
+	// workers are pinned (see setNbMechanicsThreads). Cell(position) must then be safe to
+	// run concurrently. Cells and connections created later on (divisions, collisions) are
+	// allocated by the thread that creates them
+	Cell *addCells(const vector<Vec> &positions, const vector<double> &radii = {}) {
+		const size_t n = positions.size();
+		if (n == 0) return nullptr;
+		auto encode = MortonEncoder::fromPositions(positions.begin(), positions.end());
+		vector<pair<uint64_t, size_t>> order(n);
+		for (size_t i = 0; i < n; ++i) order[i] = make_pair(encode(positions[i]), i);
+		std::sort(order.begin(), order.end());
+		Cell *block = static_cast<Cell *>(::operator new(n * sizeof(Cell)));
+		cellArenas.push_back({block, n, n});
+		forEachSlice(n, false, [&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; ++j) {
+				const size_t i = order[j].second;
+				Cell *c = new (block + j) Cell(positions[i]);
+				if (i < radii.size()) {
+					c->setBaseRadius(radii[i]);
+					c->setRadius(radii[i]);
+				}
+			}
+		});
+		cells.reserve(cells.size() + n);
+		for (size_t i = 0; i < n; ++i) cells.push_back(block + i);
+		topologyChanged();
+		connectNewCells(block, n);
+		return block;
+	}
+
+	// runs f(begin, end) on the slices of [0, n[ that match the partition blocks of n
+	// Morton ordered cells, each on the worker of its block (or f(0, n) on this thread
+	// without a mechanics pool). inOrder runs the slices one after the other
+	template <typename F> void forEachSlice(size_t n, bool inOrder, const F &f) {
+		if (!mechanicsPool) return f(0, n);
+		const size_t nbBlocks = mechanicsPool->size();
+		for (size_t b = 0; b < nbBlocks; ++b) {
+			size_t begin = n * b / nbBlocks, end = n * (b + 1) / nbBlocks;
+			mechanicsPool->submitTo(b, [&f, begin, end]() { f(begin, end); });
+			if (inOrder) mechanicsPool->waitAll();
+		}
+		mechanicsPool->waitAll();
+	}
+
+	void connectNewCells(Cell *block, size_t n) {
+		double maxRadius = 0;
+		for (size_t i = 0; i < n; ++i) maxRadius = std::max(maxRadius, block[i].getRadius());
+		Grid<Cell *> newCellsGrid(2.0 * maxRadius);
+		for (size_t i = 0; i < n; ++i) newCellsGrid.insert(block + i);
+		// candidates[i]: new cells of higher index overlapping cell i
+		vector<vector<Cell *>> candidates(n);
+		auto search = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				Cell *c = block + i;
+				vector<Cell *> &res = candidates[i];
+				for (auto &o : newCellsGrid.retrieve(c)) {
+					double r = c->getRadius() + o->getRadius();
+					if (o > c && (o->getPosition() - c->getPosition()).sqlength() <= r * r)
+						res.push_back(o);
+				}
+				std::sort(res.begin(), res.end());
+				res.erase(std::unique(res.begin(), res.end()), res.end());
+			}
+		};
+		if (mechanicsPool) {
+			const size_t nbTasks = mechanicsPool->size() * 4;
+			for (size_t t = 0; t < nbTasks; ++t) {
+				size_t begin = n * t / nbTasks, end = n * (t + 1) / nbTasks;
+				mechanicsPool->submit([&search, begin, end]() { search(begin, end); });
+			}
+			mechanicsPool->waitAll();
+		} else {
+			search(0, n);
+		}
+		// in cell order, each slice on the worker that built its cells
+		forEachSlice(n, true, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				for (auto &o : candidates[i]) block[i].connection(o, connections);
+		});
+		topologyChanged();
+	}
+
+	void deleteCell(Cell *c) {
+		std::less<Cell *> before;
+		for (auto a = cellArenas.begin(); a != cellArenas.end(); ++a) {
+			if (!before(c, a->begin) && before(c, a->begin + a->size)) {
+				c->~Cell();
+				if (--a->alive == 0) {
+					::operator delete(a->begin);
+					cellArenas.erase(a);
+				}
+				return;
+			}
+		}
+		delete c;
 	}
 
 	void destroyCells() {
 		for (auto i = cells.begin(); i != cells.end();) {
 			if ((*i)->isDead()) {
 				auto c = *i;
+				for (auto &n : c->getConnectedCells()) n->wakeUp();
 				c->eraseAndDeleteAllConnections(connections);
 				for (auto &m : models) {
 					if (cellModelConnections.count(&m.second) &&
@@ -507,8 +1087,10 @@ public:
 						cellModelConnections.at(&m.second).erase(c);
 					}
 				}
+				lastModelQueryPosition.erase(c);
 				i = cells.erase(i);
-				delete c;
+				deleteCell(c);
+				topologyChanged();
 			} else {
 				++i;
 			}
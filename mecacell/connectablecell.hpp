@@ -22,10 +22,15 @@
 using namespace std;
 
 namespace MecaCell {
-template <typename Derived> class ConnectableCell : public Movable, public Orientable {
-protected:
-	using ConnectionType = Connection<Derived *>;
+// K selects the elements stored in the cell-cell connections (see ConnectionKind): cells
+// that never use torsion joints, or no joints at all, can pick a leaner connection type
+template <typename Derived, ConnectionKind K = ConnectionKind::Full>
+class ConnectableCell : public Movable, public Orientable {
+public:
+	using ConnectionType = Connection<Derived *, Derived *, K>;
 	using ModelConnectionType = CellModelConnection<Derived>;
+
+protected:
 	bool dead = false; // is the cell dead or alive ?
 	array<double, 3> color = {{0.75, 0.12, 0.07}};
 	double radius = DEFAULT_CELL_RADIUS;
@@ -40,6 +45,11 @@ protected:
 	                                  // already connected)
 	double pressure = 1.0;
 	bool visible = true;
+	bool connectionsNeedUpdate = false; // connection update deferred by a parallel phase
+
+	// set by parallel behavior phases: connections are shared with neighbours, so
+	// updateAllConnections only flags the cell and the world updates them afterwards
+	static thread_local bool deferConnectionUpdates;
 
 public:
 	ConnectableCell(Vec pos) : Movable(pos) { randomColor(); }
@@ -212,10 +222,7 @@ public:
 						                                     c->angularStiffness),
 						                    maxTeta)));
 						double contactSurface = M_PI * (sqdist + pow((radius + c->radius) / 2, 2));
-						s->getFlex().first.setCurrentKCoef(contactSurface);
-						s->getFlex().second.setCurrentKCoef(contactSurface);
-						s->getTorsion().first.setCurrentKCoef(contactSurface);
-						s->getTorsion().second.setCurrentKCoef(contactSurface);
+						s->setJointsKCoef(contactSurface);
 						addConnection(c, s);
 
 						worldConnexions.push_back(s);
@@ -233,15 +240,25 @@ public:
 	// area
 	//  (maybe directly from World?)
 	void updateAllConnections() {
+		if (deferConnectionUpdates) {
+			connectionsNeedUpdate = true;
+			return;
+		}
+		connectionsNeedUpdate = false;
+		wakeUp();
 		for (auto &con : connections) {
 			Derived *otherCell =
 			    con->getNode0() == selfptr() ? con->getNode1() : con->getNode0();
+			otherCell->wakeUp();
 			double adhCoef =
 			    (getAdhesionWith(otherCell) + otherCell->getAdhesionWith(selfptr())) * 0.5;
 			con->setBaseLength(getConnectionLength(otherCell, adhCoef));
 		}
 	}
 
+	bool hasPendingConnectionUpdate() const { return connectionsNeedUpdate; }
+	static void setDeferConnectionUpdates(bool d) { deferConnectionUpdates = d; }
+
 	template <typename C = Derived> C *divide() { return divide<C>(Vec::randomUnit()); }
 
 	template <typename C = Derived> C *divide(const Vec &direction) {
@@ -361,5 +378,7 @@ public:
 		color[2] = 0.05 + (0.2 * r0);
 	}
 };
+template <typename Derived, ConnectionKind K>
+thread_local bool ConnectableCell<Derived, K>::deferConnectionUpdates = false;
 }
 #endif
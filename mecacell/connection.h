@@ -1,6 +1,9 @@
 #ifndef CONNECTION_H
 #define CONNECTION_H
+#include <array>
+#include <type_traits>
 #include "tools.h"
+#include "matrix3x3.h"
 
 #define MAX_TS_INCL                                                                      \
 	0.1 // max angle before we need to reproject our torsion joint rotation
@@ -11,16 +14,16 @@ namespace MecaCell {
 ////////////////////////////////////////////////////////////////////
 // This is just a classic "linear" spring
 struct Spring {
-	double k = 1.0;      // stiffness
-	double c = 1.0;      // damp coef
-	double l = 1.0;      // rest length
-	double length = 1.0; // current length
-	double prevLength = 1.0;
-	double minLengthRatio = 0.5; // max compression
+	num_t k = 1.0;      // stiffness
+	num_t c = 1.0;      // damp coef
+	num_t l = 1.0;      // rest length
+	num_t length = 1.0; // current length
+	num_t prevLength = 1.0;
+	num_t minLengthRatio = 0.5; // max compression
 	Vec direction;               // current direction from node 0 to node 1
 
 	Spring(){};
-	Spring(const double &K, const double &C, const double &L)
+	Spring(const num_t &K, const num_t &C, const num_t &L)
 	    : k(K), c(C), l(L), length(L){};
 
 	void updateLengthDirection(const Vec &p0, const Vec &p1) {
@@ -35,11 +38,11 @@ struct Spring {
 ////////////////////////////////////////////////////////////////////
 // flexible joint. Can be used for flexure (torque + force) or torsion (torque only)
 struct Joint {
-	double k = 1.0; // angular stiffness
-	double currentK = 1.0;
-	double c = 1.0;               // damp
+	num_t k = 1.0; // angular stiffness
+	num_t currentK = 1.0;
+	num_t c = 1.0;                // damp
 	double maxTeta = M_PI / 20.0; // maximum angle
-	Rotation<Vec> r;              // rotation from node to joint
+	Vec localDirection = Vec(1, 0, 0); // direction in node space
 	Rotation<Vec> delta;          // current rotation
 	Rotation<Vec> prevDelta;
 	Vec direction;                  // current direction
@@ -48,15 +51,75 @@ struct Joint {
 	bool targetUpdateEnabled = true;
 	Joint(){};
 
-	Joint(const double &K, const double &C, const double &MTETA, bool handleMteta = true)
+	Joint(const num_t &K, const num_t &C, const double &MTETA, bool handleMteta = true)
 	    : k(K), c(C), maxTeta(MTETA), maxTetaAutoCorrect(handleMteta) {}
 
-	// current direction is computed using a reference Vector v rotated with rotation rot
-	void updateDirection(const Vec &v, const Rotation<Vec> &rot) {
-		direction = v.rotated(r.rotated(rot));
+	// sets the joint's direction (world space) and its node space counterpart
+	void setDirection(const Vec &d, const Matrix3x3 &nodeOrientation) {
+		direction = d.normalized();
+		localDirection = nodeOrientation.transposedProduct(direction);
+	}
+	// current direction is the node space direction rotated by the node's orientation
+	void updateDirection(const Matrix3x3 &nodeOrientation) {
+		direction = nodeOrientation * localDirection;
 	}
 	void updateDelta() { delta = Vec::getRotation(direction, target); }
-	void setCurrentKCoef(double kc) { currentK = k * kc; }
+	void setCurrentKCoef(num_t kc) { currentK = k * kc; }
+};
+
+// damped spring force between 2 nodes. When the spring is compressed under its minimum
+// length, the nodes are pushed back apart and exchange their axial velocities. Nodes
+// that can't move (points of a model...) just ignore these corrections and the forces
+template <typename A, typename B>
+void computeSpringForces(Spring &sc, A *a, B *b, double dt) {
+	sc.updateLengthDirection(a->getPosition(), b->getPosition());
+	num_t x = sc.length - sc.l; // actual compression / elongation
+	num_t minlength = sc.minLengthRatio * sc.l;
+	if (sc.length < minlength) {
+		num_t d = minlength - sc.length;
+		Vec component0 = a->getVelocity().dot(sc.direction) * sc.direction;
+		Vec tangent0 = a->getVelocity() - component0;
+		Vec component1 = b->getVelocity().dot(sc.direction) * sc.direction;
+		Vec tangent1 = b->getVelocity() - component1;
+		a->setPosition(a->getPosition() - sc.direction * d / 2.0);
+		b->setPosition(b->getPosition() + sc.direction * d / 2.0);
+		a->setVelocity(tangent0 + component1);
+		b->setVelocity(tangent1 + component0);
+		sc.length = minlength;
+	}
+	bool compression = x < 0;
+	num_t v = sc.length - sc.prevLength;
+	num_t k = sc.k; // compression ? sc.k : sc.k * 0.2;
+	num_t f = (-k * x - sc.c * v / dt) / 2.0;
+	a->receiveForce(f, -sc.direction, compression);
+	b->receiveForce(f, sc.direction, compression);
+	sc.prevLength = sc.length;
+}
+
+// compile time subsets of the elements of a connection. Full connections store every
+// joint and can disable each element at runtime (scEnabled, fjEnabled, tjEnabled). The
+// lean kinds only store the joints they use and their enabled flags are constants, so
+// their force kernels have no runtime branches
+enum class ConnectionKind { Spring, SpringFlex, Full };
+
+template <ConnectionKind K> struct ConnectionFlags {
+	static constexpr bool scEnabled = true;
+	static constexpr bool fjEnabled = K == ConnectionKind::SpringFlex;
+	static constexpr bool tjEnabled = false;
+	static constexpr size_t nbJointPairs = K == ConnectionKind::SpringFlex ? 1 : 0;
+	void disableSpring() {}
+	void disableJoints() {}
+};
+template <ConnectionKind K> constexpr bool ConnectionFlags<K>::scEnabled;
+template <ConnectionKind K> constexpr bool ConnectionFlags<K>::fjEnabled;
+template <ConnectionKind K> constexpr bool ConnectionFlags<K>::tjEnabled;
+template <ConnectionKind K> constexpr size_t ConnectionFlags<K>::nbJointPairs;
+
+template <> struct ConnectionFlags<ConnectionKind::Full> {
+	bool scEnabled = true, fjEnabled = true, tjEnabled = false;
+	static constexpr size_t nbJointPairs = 2;
+	void disableSpring() { scEnabled = false; }
+	void disableJoints() { fjEnabled = tjEnabled = false; }
 };
 
 ////////////////////////////////////////////////////////////////////
@@ -65,44 +128,63 @@ struct Joint {
 // Connects 2 "connectable" nodes with 1 "classic" spring,
 // 1 flexure and 1 torsion joint per node. By default those 3 types of
 // connections are enabled but one can easily choose to use only a subset
-// by setting scEnabled, fjEnabled and tjEnabled accordingly.
+// by setting scEnabled, fjEnabled and tjEnabled accordingly, or at compile time with
+// the K parameter (see ConnectionKind).
 // A connectable node can directly inherit from Connectable or be a complete
 // separate implementation.
 // Required methods for a connectable class are:
 // - Vec getPosition()
 // - Vec getVelocity()
 // - Vec getAngularVelocity()
-// - Basis getOrientation()
-// - Rotation getOrientationRotation()
+// - Matrix3x3 getOrientationMatrix()
 // - double getInertia()
 // - void receiveForce(double intensity, Vec direction, bool compressive)
 // - void receiveTorque(Vec acc)
-template <typename N0, typename N1 = N0> class Connection {
+template <typename N0, typename N1 = N0, ConnectionKind K = ConnectionKind::Full>
+class Connection : public ConnectionFlags<K> {
+	using Flags = ConnectionFlags<K>;
+	static constexpr size_t NB_JOINT_PAIRS = Flags::nbJointPairs;
+	using hasJoints = std::integral_constant<bool, (NB_JOINT_PAIRS > 0)>;
+
 private:
-	pair<N0, N1> connected;    // the two connected nodes
-	Spring sc;                 // basic spring
-	pair<Joint, Joint> fj, tj; // flexure and torsion joints (1 per node)
+	pair<N0, N1> connected; // the two connected nodes
+	Spring sc;              // basic spring
+	// flexure (and torsion) joints, 1 per node
+	array<pair<Joint, Joint>, NB_JOINT_PAIRS> joints;
+
+	pair<Joint, Joint> &fj() { return joints[0]; }
+	// (spring + flex connections never reach the torsion code)
+	pair<Joint, Joint> &tj() { return joints[NB_JOINT_PAIRS - 1]; }
+
+	void setJoints(const pair<Joint, Joint> &FJ, const pair<Joint, Joint> &TJ) {
+		if (NB_JOINT_PAIRS > 0) joints.front() = FJ;
+		if (NB_JOINT_PAIRS > 1) joints.back() = TJ;
+	}
 
 public:
-	bool scEnabled = true, fjEnabled = true, tjEnabled = false;
 	/**********************************************
 	 *               CONSTRUCTOR
 	 **********************************************/
-	Connection(const pair<N0, N1> &n, const Spring &S)
-	    : connected{n}, sc(S), fjEnabled(false), tjEnabled(false) {
+	Connection(const pair<N0, N1> &n, const Spring &S) : connected{n}, sc(S) {
+		static_assert(K != ConnectionKind::SpringFlex, "flex joints need to be provided");
+		this->disableJoints();
 		initS();
 	}
 	Connection(const pair<N0, N1> &n, const pair<Joint, Joint> &FJ,
 	           const pair<Joint, Joint> &TJ)
-	    : connected{n}, fj(FJ), tj(TJ), scEnabled(false) {
+	    : connected{n} {
+		static_assert(K == ConnectionKind::Full, "lean connections always use their spring");
+		this->disableSpring();
+		setJoints(FJ, TJ);
 		initS();
-		initFJ();
+		initFJ(hasJoints());
 	}
 	Connection(const pair<N0, N1> &n, const Spring &SC, const pair<Joint, Joint> &FJ,
 	           const pair<Joint, Joint> &TJ)
-	    : connected{n}, sc(SC), fj(FJ), tj(TJ) {
+	    : connected{n}, sc(SC) {
+		setJoints(FJ, TJ);
 		initS();
-		initFJ();
+		initFJ(hasJoints());
 	}
 
 	void initS() {
@@ -110,37 +192,42 @@ public:
 		                         ptr(connected.second)->getPosition());
 		sc.prevLength = sc.length;
 	}
-	void initFJ() {
-		Vec ortho = sc.direction.ortho();
-		// rotations for joints (cell base to connection) =
-		// cellBasis -> worldBasis + worldBasis -> connectionBasis
-		fj.first.r = ptr(connected.first)->getOrientationRotation().inverted() +
-		             Vec::getRotation(Basis<Vec>(), Basis<Vec>(sc.direction, ortho));
-		fj.second.r = ptr(connected.second)->getOrientationRotation().inverted() +
-		              Vec::getRotation(Basis<Vec>(), Basis<Vec>(-sc.direction, ortho));
-		tj.first.r = fj.first.r;
-		tj.second.r = fj.second.r;
-
-		// joint's current direction
-		fj.first.updateDirection(ptr(connected.first)->getOrientation().X,
-		                         ptr(connected.first)->getOrientationRotation());
-		fj.second.updateDirection(ptr(connected.second)->getOrientation().X,
-		                          ptr(connected.second)->getOrientationRotation());
-		tj.first.updateDirection(ptr(connected.first)->getOrientation().Y,
-		                         ptr(connected.first)->getOrientationRotation());
-		tj.second.updateDirection(ptr(connected.second)->getOrientation().Y,
-		                          ptr(connected.second)->getOrientationRotation());
+	void initFJ(std::false_type) {}
+	void initFJ(std::true_type) {
+		// joints directions are stored in their node's space
+		const Matrix3x3 &m0 = ptr(connected.first)->getOrientationMatrix();
+		const Matrix3x3 &m1 = ptr(connected.second)->getOrientationMatrix();
+		fj().first.setDirection(sc.direction, m0);
+		fj().second.setDirection(-sc.direction, m1);
+		if (NB_JOINT_PAIRS > 1) {
+			Vec ortho = sc.direction.ortho();
+			tj().first.setDirection(ortho, m0);
+			tj().second.setDirection(ortho, m1);
+		}
 	}
 	/**********************************************
 	 *                GET & SET
 	 **********************************************/
 	Spring &getSc() { return sc; }
-	pair<Joint, Joint> &getFlex() { return fj; }
-	pair<Joint, Joint> &getTorsion() { return tj; }
+	pair<Joint, Joint> &getFlex() {
+		static_assert(K != ConnectionKind::Spring, "this connection has no flex joints");
+		return fj();
+	}
+	pair<Joint, Joint> &getTorsion() {
+		static_assert(K == ConnectionKind::Full, "this connection has no torsion joints");
+		return tj();
+	}
+	// scales the stiffness of all the joints (by the contact surface, usually)
+	void setJointsKCoef(num_t kc) {
+		for (auto &j : joints) {
+			j.first.setCurrentKCoef(kc);
+			j.second.setCurrentKCoef(kc);
+		}
+	}
 	N0 &getNode0() { return connected.first; }
 	N1 &getNode1() { return connected.second; }
 	float getLength() { return sc.length; }
-	void setBaseLength(const double d) { sc.l = d; }
+	void setBaseLength(const num_t d) { sc.l = d; }
 	Vec getDirection() { return sc.direction; }
 	template <typename R, typename T> R &getOtherNode(const T &n) {
 		return n == connected.first ? connected.second : connected.first;
@@ -155,77 +242,57 @@ public:
 	}
 	void computeForces(double dt) {
 		// BASIC SPRING
-		sc.updateLengthDirection(ptr(connected.first)->getPosition(),
-		                         ptr(connected.second)->getPosition());
-		if (scEnabled) {
-			double x = sc.length - sc.l; // actual compression / elongation
-			double minlength = sc.minLengthRatio * sc.l;
-			if (sc.length < minlength) {
-				double d = minlength - sc.length;
-				Vec component0 =
-				    ptr(connected.first)->getVelocity().dot(sc.direction) * sc.direction;
-				Vec tangent0 = ptr(connected.first)->getVelocity() - component0;
-				Vec component1 =
-				    ptr(connected.second)->getVelocity().dot(sc.direction) * sc.direction;
-				Vec tangent1 = ptr(connected.second)->getVelocity() - component1;
-				ptr(connected.first)
-				    ->setPosition(ptr(connected.first)->getPosition() - sc.direction * d / 2.0);
-				ptr(connected.second)
-				    ->setPosition(ptr(connected.second)->getPosition() + sc.direction * d / 2.0);
-				ptr(connected.first)->setVelocity(tangent0 + component1);
-				ptr(connected.second)->setVelocity(tangent1 + component0);
-				sc.length = minlength;
-			}
-			bool compression = x < 0;
-			double v = sc.length - sc.prevLength;
-			double k = sc.k; // compression ? sc.k : sc.k * 0.2;
-			double f = (-k * x - sc.c * v / dt) / 2.0;
-			ptr(connected.first)->receiveForce(f, -sc.direction, compression);
-			ptr(connected.second)->receiveForce(f, sc.direction, compression);
-			sc.prevLength = sc.length;
-		}
+		if (this->scEnabled)
+			computeSpringForces(sc, ptr(connected.first), ptr(connected.second), dt);
+		else
+			sc.updateLengthDirection(ptr(connected.first)->getPosition(),
+			                         ptr(connected.second)->getPosition());
+		computeJointForces();
+	}
+
+	// flexure and torsion part of computeForces (the spring must be up to date)
+	void computeJointForces() { computeJointForces(hasJoints()); }
+	void computeJointForces(std::false_type) {}
+	void computeJointForces(std::true_type) {
 		// update directions of both flex and tosion springs
-		if (fjEnabled) {
-			fj.first.updateDirection(ptr(connected.first)->getOrientation().X,
-			                         ptr(connected.first)->getOrientationRotation());
-			fj.second.updateDirection(ptr(connected.second)->getOrientation().X,
-			                          ptr(connected.second)->getOrientationRotation());
-		}
-		if (tjEnabled) {
-			tj.first.updateDirection(ptr(connected.first)->getOrientation().Y,
-			                         ptr(connected.first)->getOrientationRotation());
-			tj.second.updateDirection(ptr(connected.second)->getOrientation().Y,
-			                          ptr(connected.second)->getOrientationRotation());
+		if (this->fjEnabled || this->tjEnabled) {
+			const Matrix3x3 &m0 = ptr(connected.first)->getOrientationMatrix();
+			const Matrix3x3 &m1 = ptr(connected.second)->getOrientationMatrix();
+			if (this->fjEnabled) {
+				fj().first.updateDirection(m0);
+				fj().second.updateDirection(m1);
+			}
+			if (this->tjEnabled) {
+				tj().first.updateDirection(m0);
+				tj().second.updateDirection(m1);
+			}
 		}
-		if (tjEnabled || fjEnabled) {
+		if (this->tjEnabled || this->fjEnabled) {
 			updateFT<0>();
 			updateFT<1>();
 		}
 	}
 
 	template <int n> void updateFT() {
-		Joint &tjNode = n == 0 ? tj.first : tj.second;
-		Joint &tjOther = n == 0 ? tj.second : tj.first;
-		Joint &fjNode = n == 0 ? fj.first : fj.second;
+		Joint &tjNode = n == 0 ? tj().first : tj().second;
+		Joint &tjOther = n == 0 ? tj().second : tj().first;
+		Joint &fjNode = n == 0 ? fj().first : fj().second;
 		const auto &node = ptr(get<n>(connected));
 		const auto &other = ptr(get < n == 0 ? 1 : 0 > (connected));
 		const double sign = n == 0 ? 1 : -1;
 
-		if (fjEnabled) {
+		if (this->fjEnabled) {
 			if (fjNode.targetUpdateEnabled) fjNode.target = sc.direction * sign;
 			fjNode.updateDelta();
 			if (fjNode.maxTetaAutoCorrect &&
 			    fjNode.delta.teta > fjNode.maxTeta) { // if we passed flex break angle
 				float dif = fjNode.delta.teta - fjNode.maxTeta;
-				fjNode.r = fjNode.r + Rotation<Vec>(fjNode.delta.n, dif);
-				fjNode.direction = fjNode.direction.rotated(Rotation<Vec>(fjNode.delta.n, dif));
-				fjNode.r = node->getOrientationRotation().inverted() +
-				           Vec::getRotation(Basis<Vec>(), Basis<Vec>(fjNode.direction,
-				                                                     fjNode.direction.ortho()));
+				fjNode.setDirection(fjNode.direction.rotated(Rotation<Vec>(fjNode.delta.n, dif)),
+				                    node->getOrientationMatrix());
 			}
 			// flex torque and force
 			fjNode.delta.n.normalize();
-			double d = scEnabled ? sc.length : (ptr(connected.first)->getPosition() -
+			double d = this->scEnabled ? sc.length : (ptr(connected.first)->getPosition() -
 			                                    ptr(connected.second)->getPosition())
 			                                       .length();
 			double torque = fjNode.currentK * fjNode.delta.teta +
@@ -240,15 +307,13 @@ public:
 			node->receiveTorque(vFlex);
 			fjNode.prevDelta = fjNode.delta;
 		}
-		if (tjEnabled) {
+		if (this->tjEnabled) {
 			// updating torsion joint (needs to stay perp to sc.direction)
 			double scalar = tjNode.direction.dot(sc.direction);
 			// if the angle between our torsion spring and sc.direction is too far from 90°,
 			// we reproject & recompute it
 			if (abs(scalar) > MAX_TS_INCL) {
-				tjNode.r = node->getOrientationRotation().inverted() +
-				           Vec::getRotation(Basis<Vec>(Vec(1, 0, 0), Vec(0, 1, 0)),
-				                            Basis<Vec>(sc.direction, tjNode.direction));
+				tjNode.setDirection(tjNode.direction, node->getOrientationMatrix());
 			} else {
 				tjNode.direction = tjNode.direction.normalized() - scalar * sc.direction;
 			}
@@ -0,0 +1,268 @@
+#ifndef MECACELL_DISTRIBUTEDWORLD_HPP
+#define MECACELL_DISTRIBUTEDWORLD_HPP
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "basicworld.hpp"
+#include "transport.h"
+
+namespace MecaCell {
+
+// default cell (de)serialization for DistributedWorld: only the mechanical state of a
+// ConnectableCell is exchanged. Cells with their own state (genomes, counters...) must
+// provide a codec with the same three static methods
+template <typename Cell> struct DefaultCellCodec {
+	static Cell *create(const Vec &position) { return new Cell(position); }
+	static void write(MessageBuffer &m, const Cell &c) {
+		m.write(c.getPosition());
+		m.write(c.getPrevposition());
+		m.write(c.getVelocity());
+		m.write(c.getAngularVelocity());
+		const Quaternion &q = c.getOrientationQuaternion();
+		m.write(q.v);
+		m.write(q.w);
+		m.write(c.getRadius());
+		m.write(c.getBaseRadius());
+		m.write(c.getMass());
+		m.write(c.getBaseMass());
+		m.write(c.getStiffness());
+		m.write(c.getAngularStiffness());
+	}
+	static void read(MessageBuffer &m, Cell &c) {
+		c.setPosition(m.read<Vec>());
+		c.setPrevposition(m.read<Vec>());
+		c.setVelocity(m.read<Vec>());
+		c.setAngularVelocity(m.read<Vec>());
+		Vec qv = m.read<Vec>();
+		double qw = m.read<double>();
+		c.setOrientationQuaternion(Quaternion(qv.x, qv.y, qv.z, qw));
+		c.setRadius(m.read<double>());
+		c.setBaseRadius(m.read<double>());
+		c.setMass(m.read<double>());
+		c.setBaseMass(m.read<double>());
+		c.setStiffness(m.read<double>());
+		c.setAngularStiffness(m.read<double>());
+	}
+};
+
+////////////////////////////////////////////////////////////////////
+//                    DISTRIBUTED WORLD
+////////////////////////////////////////////////////////////////////
+// Domain decomposed world: space is cut in slabs along the x axis and each rank owns
+// the cells whose center lies in its slab. After each integration (and thus before
+// contacts are detected and before the next forces are computed), ranks send to
+// their neighbours the cells lying less than ghostWidth away from the shared boundary
+// (ghosts) and the cells that crossed it (migrants).
+// Ghosts are regular cells of the local world with their movement disabled: they are
+// refreshed by their owner, keep their connections from one step to the next and never
+// run their behavior. A migrant that was already a ghost on its new rank is simply
+// promoted, so connections survive migrations; the sender demotes it to a ghost.
+// ghostWidth must be larger than the interaction range (2 radii of the largest cells)
+// plus the largest displacement of a cell during one step.
+// Transport must provide getRank(), getSize(), send(rank, MessageBuffer) and
+// receive(rank, MessageBuffer &) (see SocketTransport).
+#ifdef MECACELL_SOCKET_TRANSPORT
+template <typename Cell, typename Integrator, typename Codec = DefaultCellCodec<Cell>,
+          typename Transport = SocketTransport>
+#else
+template <typename Cell, typename Integrator, typename Codec, typename Transport>
+#endif
+class DistributedWorld : public BasicWorld<Cell, Integrator> {
+	using Base = BasicWorld<Cell, Integrator>;
+
+protected:
+	Transport &transport;
+	int rank, nbRanks;
+	vector<double> bounds; // slab r is [bounds[r], bounds[r + 1])
+	double ghostWidth = 4.0 * DEFAULT_CELL_RADIUS;
+
+	uint64_t nextLocalId = 0;
+	unordered_map<Cell *, uint64_t> ids;
+	unordered_map<uint64_t, Cell *> byId;
+	unordered_set<Cell *> ghosts;
+	MessageBuffer outBuffers[2], inBuffer; // 0 = left neighbour, 1 = right neighbour
+
+	enum RecordType : uint8_t { GHOST = 0, MIGRANT = 1 };
+
+public:
+	// uniform slabs between xMin and xMax; the first and last slabs extend to infinity
+	DistributedWorld(Transport &t, double xMin, double xMax)
+	    : transport(t), rank(t.getRank()), nbRanks(t.getSize()) {
+		bounds.resize(nbRanks + 1);
+		for (int r = 0; r <= nbRanks; ++r) bounds[r] = xMin + (xMax - xMin) * r / nbRanks;
+		bounds.front() = -std::numeric_limits<double>::infinity();
+		bounds.back() = std::numeric_limits<double>::infinity();
+	}
+
+	int getRank() const { return rank; }
+	double getGhostWidth() const { return ghostWidth; }
+	void setGhostWidth(const double w) { ghostWidth = w; }
+	const vector<double> &getBounds() const { return bounds; }
+	bool isGhost(Cell *c) const { return ghosts.count(c) > 0; }
+	size_t getNbGhosts() const { return ghosts.size(); }
+	size_t getNbOwnedCells() const { return this->cells.size() - ghosts.size(); }
+	uint64_t getId(Cell *c) const { return ids.at(c); }
+
+	// the adaptive time step is not synchronized across ranks: they would integrate with
+	// different dts while exchanging ghosts at every step (update() throws if it was
+	// enabled through a BasicWorld reference)
+	void enableAdaptiveDt(double, double, double = 0) = delete;
+
+	int getOwner(const Vec &p) const {
+		return std::upper_bound(bounds.begin() + 1, bounds.end() - 1, p.x) -
+		       (bounds.begin() + 1);
+	}
+	bool isLocal(const Vec &p) const { return getOwner(p) == rank; }
+
+	// cells can be added on every rank (typically by a shared setup): only the rank owning
+	// their position keeps them
+	void addCell(Cell *c) {
+		if (!c) return;
+		if (isLocal(c->getPosition()))
+			Base::addCell(c);
+		else
+			delete c;
+	}
+
+	Cell *addCells(const vector<Vec> &positions, const vector<double> &radii = {}) {
+		vector<Vec> localPositions;
+		vector<double> localRadii;
+		for (size_t i = 0; i < positions.size(); ++i) {
+			if (!isLocal(positions[i])) continue;
+			localPositions.push_back(positions[i]);
+			if (i < radii.size()) localRadii.push_back(radii[i]);
+		}
+		return Base::addCells(localPositions, localRadii);
+	}
+
+	void update() {
+		if (this->adaptiveDt)
+			throw std::runtime_error("DistributedWorld: adaptive time steps are not supported");
+		this->behaviorDt = 0;
+		for (int s = 0; s < this->nbMechanicalSubsteps; ++s) {
+			this->integrationStep();
+			exchange();
+			this->collisionStep();
+			if (s + 1 < this->nbMechanicalSubsteps) this->resetForces();
+		}
+		// behaviors only run on owned cells
+		vector<Cell *> ghostCells;
+		auto isGhostCell = [&](Cell *c) { return ghosts.count(c) > 0; };
+		for (auto &c : this->cells)
+			if (isGhostCell(c)) ghostCells.push_back(c);
+		this->cells.erase(remove_if(this->cells.begin(), this->cells.end(), isGhostCell),
+		                  this->cells.end());
+		this->updateBehavior();
+		forgetDeadCells();
+		this->destroyCells();
+		this->updateStats();
+		this->cells.insert(this->cells.end(), ghostCells.begin(), ghostCells.end());
+		this->resetForces();
+		this->periodicReorder();
+		++this->frame;
+	}
+
+	// sends ghosts and migrants to the neighbours and integrates theirs
+	void exchange() {
+		for (auto &b : outBuffers) b.clear();
+		// ghosts that are not refreshed by their owner are removed, except the cells we
+		// send away now (their new owner only learns about them with this message)
+		unordered_set<Cell *> refreshed;
+		for (auto &c : this->cells) {
+			if (ghosts.count(c)) continue;
+			if (!ids.count(c)) registerCell(c, uint64_t(nbRanks) * nextLocalId++ + rank);
+			const Vec &p = c->getPosition();
+			int owner = getOwner(p);
+			if (owner != rank) {
+				writeRecord(outBuffers[owner < rank ? 0 : 1], MIGRANT, c);
+				makeGhost(c);
+				refreshed.insert(c);
+			} else {
+				if (rank > 0 && p.x < bounds[rank] + ghostWidth)
+					writeRecord(outBuffers[0], GHOST, c);
+				if (rank < nbRanks - 1 && p.x >= bounds[rank + 1] - ghostWidth)
+					writeRecord(outBuffers[1], GHOST, c);
+			}
+		}
+		// pipelined: everybody sends right then receives from the left, and the other way
+		// around, so that blocking sends can't deadlock
+		if (rank < nbRanks - 1) transport.send(rank + 1, outBuffers[1]);
+		if (rank > 0) receiveFrom(rank - 1, refreshed);
+		if (rank > 0) transport.send(rank - 1, outBuffers[0]);
+		if (rank < nbRanks - 1) receiveFrom(rank + 1, refreshed);
+		bool stale = false;
+		for (auto &c : ghosts) {
+			if (!refreshed.count(c)) {
+				c->die();
+				stale = true;
+			}
+		}
+		if (stale) {
+			forgetDeadCells();
+			this->destroyCells();
+		}
+	}
+
+protected:
+	void registerCell(Cell *c, uint64_t id) {
+		ids[c] = id;
+		byId[id] = c;
+	}
+
+	void makeGhost(Cell *c) {
+		ghosts.insert(c);
+		c->disableMovement();
+	}
+
+	void writeRecord(MessageBuffer &m, RecordType type, Cell *c) {
+		m.write(type);
+		m.write(ids[c]);
+		Codec::write(m, *c);
+	}
+
+	void receiveFrom(int from, unordered_set<Cell *> &refreshed) {
+		transport.receive(from, inBuffer);
+		while (!inBuffer.atEnd()) {
+			RecordType type = inBuffer.read<RecordType>();
+			uint64_t id = inBuffer.read<uint64_t>();
+			Cell *c = nullptr;
+			auto it = byId.find(id);
+			if (it != byId.end()) {
+				c = it->second;
+			} else {
+				c = Codec::create(Vec::zero());
+				registerCell(c, id);
+				Base::addCell(c);
+				if (type == GHOST) makeGhost(c);
+			}
+			Codec::read(inBuffer, *c);
+			if (type == MIGRANT) {
+				ghosts.erase(c);
+				refreshed.erase(c);
+				c->enableMovement();
+			} else {
+				refreshed.insert(c);
+			}
+			c->wakeUp();
+		}
+	}
+
+	// removes the dead cells from the bookkeeping, right before destroyCells deletes them
+	void forgetDeadCells() {
+		for (auto &c : this->cells) {
+			if (!c->isDead()) continue;
+			auto it = ids.find(c);
+			if (it != ids.end()) {
+				byId.erase(it->second);
+				ids.erase(it);
+			}
+			ghosts.erase(c);
+		}
+	}
+};
+}
+#endif
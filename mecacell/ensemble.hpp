@@ -0,0 +1,94 @@
+#ifndef MECACELL_ENSEMBLE_HPP
+#define MECACELL_ENSEMBLE_HPP
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "model.h"
+#include "threadpool.hpp"
+
+namespace MecaCell {
+
+// default per-run summary
+struct RunSummary {
+	size_t run = 0;
+	int nbUpdates = 0;
+	size_t nbCells = 0;
+	size_t nbConnections = 0;
+};
+
+////////////////////////////////////////////////////////////////////
+//                     ENSEMBLE RUNNER
+////////////////////////////////////////////////////////////////////
+// Runs many independent worlds (typically a parameter sweep) inside the same process.
+// Each run builds its own World on one of the pool's workers, calls setup, updates it
+// nbSteps times and reduces it to a Summary; summaries are returned in run order.
+// Models are parsed once by the ensemble and their geometry is shared by every world.
+// Runs must not share mutable state: setup and summary are called concurrently.
+// globalRand is reseeded at the start of each run from the ensemble's seed and the run
+// index, so a run gives the same results whatever the worker it lands on.
+template <typename World, typename Summary = RunSummary> class Ensemble {
+public:
+	using setup_fn = std::function<void(World &, size_t)>;
+	using summary_fn = std::function<Summary(World &, size_t)>;
+	using step_fn = std::function<void(World &, size_t)>;
+
+private:
+	WorkStealingPool pool;
+	unordered_map<string, shared_ptr<const ModelData>> models;
+	vector<double> durations; // wall clock duration of each run, in seconds
+	unsigned int seed = 0;
+
+public:
+	Ensemble(size_t nbThreads = std::thread::hardware_concurrency()) : pool(nbThreads) {}
+
+	// parses the obj file once; every world created by run() will contain this model
+	void addModel(const string &name, const string &path) {
+		models[name] = std::make_shared<const ModelData>(path);
+	}
+	const unordered_map<string, shared_ptr<const ModelData>> &getModels() const {
+		return models;
+	}
+	const vector<double> &getDurations() const { return durations; }
+	size_t getNbThreads() const { return pool.size(); }
+	unsigned int getSeed() const { return seed; }
+	void setSeed(const unsigned int s) { seed = s; }
+
+	static Summary defaultSummary(World &w, size_t run) {
+		Summary s;
+		s.run = run;
+		s.nbUpdates = w.getNbUpdates();
+		s.nbCells = w.cells.size();
+		s.nbConnections = w.connections.size();
+		return s;
+	}
+
+	// step defaults to a plain world update. It receives the index of the run so that
+	// scenarios can plug their own loop (events, perturbations...)
+	vector<Summary> run(size_t nbRuns, int nbSteps, const setup_fn &setup,
+	                    const summary_fn &summary = defaultSummary,
+	                    const step_fn &step = [](World &w, size_t) { w.update(); }) {
+		vector<Summary> res(nbRuns);
+		durations.assign(nbRuns, 0.0);
+		for (size_t r = 0; r < nbRuns; ++r) {
+			pool.submit([this, r, nbSteps, &setup, &summary, &step, &res]() {
+				auto t0 = std::chrono::steady_clock::now();
+				std::seed_seq seq{seed, static_cast<unsigned int>(r)};
+				globalRand.seed(seq);
+				World w;
+				for (const auto &m : models) w.addModel(m.first, m.second);
+				setup(w, r);
+				for (int i = 0; i < nbSteps; ++i) step(w, r);
+				res[r] = summary(w, r);
+				durations[r] =
+				    std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			});
+		}
+		pool.waitAll();
+		return res;
+	}
+};
+}
+#endif
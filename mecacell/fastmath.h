@@ -0,0 +1,70 @@
+#ifndef MECACELL_FASTMATH_H
+#define MECACELL_FASTMATH_H
+#include <algorithm>
+#include <cmath>
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                   TRIG FREE ROTATION HELPERS
+////////////////////////////////////////////////////////////////////
+// Joints and orientations mostly deal with small rotations (joints break past maxTeta).
+// For those, the half angle sine and cosine and the angle itself are computed with short
+// polynomials instead of sin, cos and acos calls. Larger angles take the libm path.
+// Both paths agree to ~1e-13 (see the "Fast rotation primitives" test).
+
+// sine and cosine of x, |x| <= pi / 4: Taylor series up to x^14 (error < 3e-14)
+inline void smallAngleSinCos(double x, double &s, double &c) {
+	const double x2 = x * x;
+	s = x * (1.0 -
+	         x2 * (1.0 / 6.0) *
+	             (1.0 -
+	              x2 * (1.0 / 20.0) *
+	                  (1.0 -
+	                   x2 * (1.0 / 42.0) *
+	                       (1.0 -
+	                        x2 * (1.0 / 72.0) *
+	                            (1.0 - x2 * (1.0 / 110.0) * (1.0 - x2 * (1.0 / 156.0)))))));
+	c = 1.0 -
+	    x2 * 0.5 *
+	        (1.0 -
+	         x2 * (1.0 / 12.0) *
+	             (1.0 -
+	              x2 * (1.0 / 30.0) *
+	                  (1.0 -
+	                   x2 * (1.0 / 56.0) *
+	                       (1.0 -
+	                        x2 * (1.0 / 90.0) *
+	                            (1.0 - x2 * (1.0 / 132.0) * (1.0 - x2 * (1.0 / 182.0)))))));
+}
+
+// sine and cosine of angle / 2, for rotations and quaternions built from an axis & angle
+inline void halfAngleSinCos(double angle, double &s, double &c) {
+	const double halfangle = angle * 0.5;
+	if (std::fabs(halfangle) <= M_PI / 4.0) {
+		smallAngleSinCos(halfangle, s, c);
+	} else {
+		s = std::sin(halfangle);
+		c = std::cos(halfangle);
+	}
+}
+
+// asin(x), 0 <= x <= 0.25: Taylor series up to x^15 (error < 1e-12)
+inline double smallAsin(double x) {
+	const double x2 = x * x;
+	return x * (1.0 +
+	            x2 * (1.0 / 6.0 +
+	                  x2 * (3.0 / 40.0 +
+	                        x2 * (5.0 / 112.0 +
+	                              x2 * (35.0 / 1152.0 +
+	                                    x2 * (63.0 / 2816.0 +
+	                                          x2 * (231.0 / 13312.0 +
+	                                                x2 * (143.0 / 10240.0))))))));
+}
+
+// angle of a rotation from the sine and cosine of its half angle (s >= 0)
+inline double angleFromHalfSinCos(double s, double c) {
+	if (s <= 0.25 && c > 0) return 2.0 * smallAsin(s);
+	return 2.0 * std::acos(std::min<double>(1.0, std::max<double>(-1.0, c)));
+}
+}
+#endif
@@ -0,0 +1,248 @@
+#ifndef MECACELL_FLATGRID_HPP
+#define MECACELL_FLATGRID_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "threadpool.hpp"
+#include "tools.h"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                         FLAT GRID
+////////////////////////////////////////////////////////////////////
+// Same buckets and queries as Grid, stored in flat arrays rebuilt from scratch by
+// build(objects, pool), which all the workers of the pool run together:
+// 1. the bucket range of each object is computed and the number of entries summed
+// 2. buckets are claimed in an open addressing table (compare and swap on their key) and
+//    their sizes are counted with atomic counters
+// 3. a prefix sum of the counts gives each bucket its range in one entries array
+// 4. objects are scattered in these ranges (atomic cursors), then each bucket is sorted
+//    back to the objects order
+// Buckets thus hold their objects in the same order as Grid and are visited in the same
+// order, so both grids return the same candidates in the same order whatever the number
+// of threads. Bucket coordinates are packed on 21 bits: a grid spanning more than 2^21
+// buckets along an axis aliases far away buckets, which only adds candidates.
+template <typename O> class FlatGrid {
+	struct Range {
+		int m[3], M[3]; // inclusive bucket coordinates
+	};
+
+	num_t cellSize; // actually it's 1/cellSize, as in Grid
+	std::vector<O> objects;
+	std::vector<Range> ranges;
+	size_t capacity = 0; // table size, a power of 2
+	int capacityBits = 0;
+	std::unique_ptr<std::atomic<uint64_t>[]> keys;
+	std::unique_ptr<std::atomic<uint32_t>[]> counts;
+	std::vector<uint32_t> offsets; // bucket of slot s is entries[offsets[s], offsets[s+1][
+	std::vector<uint32_t> entries; // indices in objects
+	std::vector<O> content;        // objects of the entries, bucket after bucket
+	std::vector<size_t> chunkSums;
+
+	static uint64_t emptyKey() { return ~0ull; }
+	static uint64_t packKey(int i, int j, int k) {
+		const uint64_t mask = 0x1fffff, offset = 1 << 20;
+		return ((static_cast<uint64_t>(i + offset) & mask) << 42) |
+		       ((static_cast<uint64_t>(j + offset) & mask) << 21) |
+		       (static_cast<uint64_t>(k + offset) & mask);
+	}
+	static Vec unpackKey(uint64_t key) {
+		const uint64_t mask = 0x1fffff;
+		const int offset = 1 << 20;
+		return Vec(static_cast<int>((key >> 42) & mask) - offset,
+		           static_cast<int>((key >> 21) & mask) - offset,
+		           static_cast<int>(key & mask) - offset);
+	}
+	size_t firstSlot(uint64_t key) const {
+		// fibonacci hashing: the high bits of the product depend on all the coordinates
+		return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> (64 - capacityBits));
+	}
+
+	// same bucket range as Grid::insert and Grid::retrieve
+	Range rangeOf(const Vec &p, num_t r) const {
+		Vec center = p * cellSize;
+		num_t radius = r * cellSize;
+		Vec minCorner = center - radius;
+		Vec maxCorner = center + radius;
+		return {{double2int(minCorner.x), double2int(minCorner.y), double2int(minCorner.z)},
+		        {double2int(maxCorner.x), double2int(maxCorner.y), double2int(maxCorner.z)}};
+	}
+	static size_t volume(const Range &r) {
+		return static_cast<size_t>(r.M[0] - r.m[0] + 1) * (r.M[1] - r.m[1] + 1) *
+		       (r.M[2] - r.m[2] + 1);
+	}
+	template <typename F> static void forEachKey(const Range &r, const F &f) {
+		for (int i = r.m[0]; i <= r.M[0]; ++i)
+			for (int j = r.m[1]; j <= r.M[1]; ++j)
+				for (int k = r.m[2]; k <= r.M[2]; ++k) f(packKey(i, j, k));
+	}
+
+	size_t claim(uint64_t key) {
+		for (size_t s = firstSlot(key);; s = (s + 1) & (capacity - 1)) {
+			uint64_t k = keys[s].load(std::memory_order_relaxed);
+			if (k == emptyKey()) {
+				if (keys[s].compare_exchange_strong(k, key, std::memory_order_relaxed)) return s;
+			}
+			if (k == key) return s;
+		}
+	}
+	// slot of a bucket, capacity if it is empty
+	size_t find(uint64_t key) const {
+		if (entries.empty()) return capacity;
+		for (size_t s = firstSlot(key);; s = (s + 1) & (capacity - 1)) {
+			uint64_t k = keys[s].load(std::memory_order_relaxed);
+			if (k == key) return s;
+			if (k == emptyKey()) return capacity;
+		}
+	}
+
+	// f(chunk, begin, end) over nbChunks contiguous chunks of [0, n[, on the pool if any
+	template <typename F>
+	static void forEachChunk(WorkStealingPool *pool, size_t n, size_t nbChunks,
+	                         const F &f) {
+		for (size_t t = 0; t < nbChunks; ++t) {
+			size_t begin = n * t / nbChunks, end = n * (t + 1) / nbChunks;
+			if (pool)
+				pool->submit([&f, t, begin, end]() { f(t, begin, end); });
+			else
+				f(t, begin, end);
+		}
+		if (pool) pool->waitAll();
+	}
+
+	// table for up to nbBuckets buckets (load factor <= 1/2)
+	void reserve(size_t nbBuckets) {
+		size_t c = 16;
+		int bits = 4;
+		for (; c < 2 * nbBuckets; c *= 2) ++bits;
+		if (c == capacity) return;
+		capacity = c;
+		capacityBits = bits;
+		keys.reset(new std::atomic<uint64_t>[capacity]);
+		counts.reset(new std::atomic<uint32_t>[capacity]);
+		offsets.resize(capacity + 1);
+	}
+
+public:
+	FlatGrid(num_t cs) : cellSize(1.0 / cs) {}
+
+	num_t getCellSize() const { return 1.0 / cellSize; }
+
+	// rebuilds the grid from objects, with the workers of pool (serial if null)
+	void build(const std::vector<O> &objs, WorkStealingPool *pool = nullptr) {
+		objects = objs;
+		const size_t n = objects.size();
+		const size_t nbChunks = pool ? pool->size() * 4 : 1;
+		ranges.resize(n);
+		forEachChunk(pool, n, nbChunks, [this](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				ranges[i] = rangeOf(ptr(objects[i])->getPosition(), ptr(objects[i])->getRadius());
+		});
+		// there are at most as many buckets as entries, and as buckets in the bounding box
+		size_t nbEntries = 0;
+		Range box = {{0, 0, 0}, {-1, -1, -1}};
+		if (n > 0) box = ranges[0];
+		for (const auto &r : ranges) {
+			nbEntries += volume(r);
+			for (int d = 0; d < 3; ++d) {
+				box.m[d] = std::min(box.m[d], r.m[d]);
+				box.M[d] = std::max(box.M[d], r.M[d]);
+			}
+		}
+		double boxVolume = 1;
+		for (int d = 0; d < 3; ++d) boxVolume *= static_cast<double>(box.M[d] - box.m[d] + 1);
+		reserve(std::min<double>(nbEntries, boxVolume));
+		forEachChunk(pool, capacity, nbChunks, [this](size_t, size_t begin, size_t end) {
+			for (size_t s = begin; s < end; ++s) {
+				keys[s].store(emptyKey(), std::memory_order_relaxed);
+				counts[s].store(0, std::memory_order_relaxed);
+			}
+		});
+		// claim & count
+		forEachChunk(pool, n, nbChunks, [this](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				forEachKey(ranges[i], [this](uint64_t key) {
+					counts[claim(key)].fetch_add(1, std::memory_order_relaxed);
+				});
+		});
+		// prefix sum: chunk sums, then offsets within each chunk
+		chunkSums.assign(nbChunks + 1, 0);
+		forEachChunk(pool, capacity, nbChunks, [this](size_t t, size_t begin, size_t end) {
+			size_t sum = 0;
+			for (size_t s = begin; s < end; ++s)
+				sum += counts[s].load(std::memory_order_relaxed);
+			chunkSums[t + 1] = sum;
+		});
+		for (size_t t = 0; t < nbChunks; ++t) chunkSums[t + 1] += chunkSums[t];
+		forEachChunk(pool, capacity, nbChunks, [this](size_t t, size_t begin, size_t end) {
+			size_t sum = chunkSums[t];
+			for (size_t s = begin; s < end; ++s) {
+				offsets[s] = sum;
+				sum += counts[s].load(std::memory_order_relaxed);
+			}
+		});
+		offsets[capacity] = nbEntries;
+		// scatter (counts are used as cursors, from the end of each bucket)
+		entries.resize(nbEntries);
+		forEachChunk(pool, n, nbChunks, [this](size_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				forEachKey(ranges[i], [this, i](uint64_t key) {
+					size_t s = find(key);
+					uint32_t pos = counts[s].fetch_sub(1, std::memory_order_relaxed) - 1;
+					entries[offsets[s] + pos] = static_cast<uint32_t>(i);
+				});
+		});
+		content.resize(nbEntries);
+		forEachChunk(pool, capacity, nbChunks, [this](size_t, size_t begin, size_t end) {
+			for (size_t s = begin; s < end; ++s) {
+				if (offsets[s + 1] - offsets[s] > 1)
+					std::sort(entries.begin() + offsets[s], entries.begin() + offsets[s + 1]);
+				for (uint32_t e = offsets[s]; e < offsets[s + 1]; ++e)
+					content[e] = objects[entries[e]];
+			}
+		});
+	}
+
+	void clear() {
+		objects.clear();
+		entries.clear();
+	}
+
+	size_t getNbEntries() const { return content.size(); }
+
+	// appends the objects of the buckets overlapped by the sphere (coord, r) to res
+	void retrieve(const Vec &coord, num_t r, std::vector<O> &res) const {
+		forEachKey(rangeOf(coord, r), [this, &res](uint64_t key) {
+			size_t s = find(key);
+			if (s == capacity) return;
+			res.insert(res.end(), content.begin() + offsets[s],
+			           content.begin() + offsets[s + 1]);
+		});
+	}
+	std::vector<O> retrieve(const Vec &coord, num_t r) const {
+		std::vector<O> res;
+		retrieve(coord, r, res);
+		return res;
+	}
+	std::vector<O> retrieve(const O &obj) const {
+		return retrieve(ptr(obj)->getPosition(), ptr(obj)->getRadius());
+	}
+
+	// (bucket coordinates, content) of the non empty buckets, for display
+	std::vector<std::pair<Vec, std::vector<O>>> getContent() const {
+		std::vector<std::pair<Vec, std::vector<O>>> res;
+		if (entries.empty()) return res;
+		for (size_t s = 0; s < capacity; ++s) {
+			if (offsets[s + 1] == offsets[s]) continue;
+			std::vector<O> bucket(content.begin() + offsets[s],
+			                      content.begin() + offsets[s + 1]);
+			res.push_back(std::make_pair(unpackKey(keys[s].load()), std::move(bucket)));
+		}
+		return res;
+	}
+};
+}
+#endif
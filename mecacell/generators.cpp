@@ -0,0 +1,387 @@
+#include "generators.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace MecaCell {
+
+// uniform grid of cells of size minDist / sqrt(3) (at most one point per cell) over a
+// box, used to reject points too close to the already accepted ones
+struct SampleGrid {
+	Vec origin;
+	double cellSize;
+	int nx, ny, nz;
+	std::vector<int> cells; // index of the point in the cell, -1 if empty
+
+	SampleGrid(const Vec &minCorner, const Vec &maxCorner, double minDist)
+	    : origin(minCorner), cellSize(minDist / sqrt(3.0)) {
+		Vec extent = maxCorner - minCorner;
+		nx = std::max(1, static_cast<int>(ceil(extent.x / cellSize)) + 1);
+		ny = std::max(1, static_cast<int>(ceil(extent.y / cellSize)) + 1);
+		nz = std::max(1, static_cast<int>(ceil(extent.z / cellSize)) + 1);
+		cells.assign(static_cast<size_t>(nx) * ny * nz, -1);
+	}
+
+	int coord(double v, double o, int n) const {
+		return std::min(n - 1, std::max(0, static_cast<int>(floor((v - o) / cellSize))));
+	}
+
+	bool farEnough(const Vec &p, const std::vector<Vec> &points, double minDist) const {
+		int x = coord(p.x, origin.x, nx), y = coord(p.y, origin.y, ny),
+		    z = coord(p.z, origin.z, nz);
+		for (int i = std::max(0, x - 2); i <= std::min(nx - 1, x + 2); ++i)
+			for (int j = std::max(0, y - 2); j <= std::min(ny - 1, y + 2); ++j)
+				for (int k = std::max(0, z - 2); k <= std::min(nz - 1, z + 2); ++k) {
+					int id = cells[(static_cast<size_t>(i) * ny + j) * nz + k];
+					if (id >= 0 && (points[id] - p).sqlength() < minDist * minDist) return false;
+				}
+		return true;
+	}
+
+	void insert(const Vec &p, int id) {
+		size_t x = coord(p.x, origin.x, nx), y = coord(p.y, origin.y, ny),
+		       z = coord(p.z, origin.z, nz);
+		cells[(x * ny + y) * nz + z] = id;
+	}
+};
+
+static void modelBounds(const Model &m, Vec &minCorner, Vec &maxCorner) {
+	const double inf = std::numeric_limits<double>::infinity();
+	minCorner = Vec(inf);
+	maxCorner = Vec(-inf);
+	for (const auto &v : m.vertices) {
+		minCorner = Vec(std::min(minCorner.x, v.x), std::min(minCorner.y, v.y),
+		                std::min(minCorner.z, v.z));
+		maxCorner = Vec(std::max(maxCorner.x, v.x), std::max(maxCorner.y, v.y),
+		                std::max(maxCorner.z, v.z));
+	}
+}
+
+static bool inBox(const Vec &p, const Vec &minCorner, const Vec &maxCorner) {
+	return p.x >= minCorner.x && p.y >= minCorner.y && p.z >= minCorner.z &&
+	       p.x <= maxCorner.x && p.y <= maxCorner.y && p.z <= maxCorner.z;
+}
+
+std::vector<Vec> hexagonalClosePacking(const Vec &minCorner, const Vec &maxCorner,
+                                       double spacing) {
+	std::vector<Vec> res;
+	const double r = spacing * 0.5;
+	const double dy = sqrt(3.0) * r, dz = 2.0 * sqrt(6.0) / 3.0 * r;
+	Vec extent = maxCorner - minCorner;
+	int nx = static_cast<int>(extent.x / spacing) + 1;
+	int ny = static_cast<int>(extent.y / dy) + 1;
+	int nz = static_cast<int>(extent.z / dz) + 1;
+	for (int k = 0; k < nz; ++k)
+		for (int j = 0; j < ny; ++j)
+			for (int i = 0; i < nx; ++i) {
+				Vec p = minCorner + Vec((2 * i + ((j + k) % 2)) * r, dy * (j + (k % 2) / 3.0),
+				                        dz * k);
+				if (inBox(p, minCorner, maxCorner)) res.push_back(p);
+			}
+	return res;
+}
+
+std::vector<Vec> jitteredLattice(const Vec &minCorner, const Vec &maxCorner,
+                                 double spacing, double jitter,
+                                 std::default_random_engine &rng) {
+	std::vector<Vec> res;
+	std::uniform_real_distribution<double> d(-jitter * spacing, jitter * spacing);
+	Vec extent = maxCorner - minCorner;
+	int nx = static_cast<int>(extent.x / spacing) + 1;
+	int ny = static_cast<int>(extent.y / spacing) + 1;
+	int nz = static_cast<int>(extent.z / spacing) + 1;
+	for (int k = 0; k < nz; ++k)
+		for (int j = 0; j < ny; ++j)
+			for (int i = 0; i < nx; ++i) {
+				double jx = d(rng), jy = d(rng), jz = d(rng);
+				res.push_back(minCorner + spacing * Vec(i, j, k) + Vec(jx, jy, jz));
+			}
+	return res;
+}
+
+// Möller - Trumbore, only hits in front of the origin count
+static bool rayHitsTriangle(const Vec &o, const Vec &dir, const Vec &v0, const Vec &v1,
+                            const Vec &v2) {
+	const double eps = 1e-12;
+	Vec e1 = v1 - v0, e2 = v2 - v0;
+	Vec p = dir.cross(e2);
+	double det = e1.dot(p);
+	if (fabs(det) < eps) return false;
+	double inv = 1.0 / det;
+	Vec s = o - v0;
+	double u = s.dot(p) * inv;
+	if (u < 0 || u > 1) return false;
+	Vec q = s.cross(e1);
+	double v = dir.dot(q) * inv;
+	if (v < 0 || u + v > 1) return false;
+	return e2.dot(q) * inv > 0;
+}
+
+// odd direction, so that inside test rays are unlikely to go through edges or vertices
+static Vec insideRayDirection() { return Vec(0.8017, 0.5345, 0.2672).normalized(); }
+
+static bool rayHitsFace(const Model &m, size_t f, const Vec &p, const Vec &dir) {
+	const Triangle &t = m.data->obj.faces[f];
+	return rayHitsTriangle(p, dir, m.vertices[t.indices[0]], m.vertices[t.indices[1]],
+	                       m.vertices[t.indices[2]]);
+}
+
+static double distanceToFace(const Model &m, size_t f, const Vec &p) {
+	const Triangle &t = m.data->obj.faces[f];
+	const Vec &v0 = m.vertices[t.indices[0]], &v1 = m.vertices[t.indices[1]],
+	          &v2 = m.vertices[t.indices[2]];
+	std::pair<bool, Vec> proj = projectionIntriangle(v0, v1, v2, p);
+	return proj.first ? (p - proj.second).length()
+	                  : closestDistToTriangleEdge(v0, v1, v2, p);
+}
+
+bool isInsideModel(const Model &m, const Vec &p) {
+	const Vec dir = insideRayDirection();
+	int nbHits = 0;
+	for (size_t f = 0; f < m.data->obj.faces.size(); ++f)
+		if (rayHitsFace(m, f, p, dir)) ++nbHits;
+	return nbHits % 2 == 1;
+}
+
+double distanceToModel(const Model &m, const Vec &p) {
+	double res = std::numeric_limits<double>::infinity();
+	for (size_t f = 0; f < m.data->obj.faces.size(); ++f)
+		res = std::min(res, distanceToFace(m, f, p));
+	return res;
+}
+
+// uniform grid of buckets over a box, each face being stored in every bucket overlapped
+// by its bounding box
+struct FaceBuckets {
+	Vec origin;
+	double cellSize;
+	int nx, ny, nz;
+	std::vector<std::vector<size_t>> buckets;
+
+	FaceBuckets(const Vec &minCorner, const Vec &maxCorner, double cs)
+	    : origin(minCorner), cellSize(cs) {
+		Vec extent = maxCorner - minCorner;
+		nx = std::max(1, static_cast<int>(ceil(extent.x / cellSize)));
+		ny = std::max(1, static_cast<int>(ceil(extent.y / cellSize)));
+		nz = std::max(1, static_cast<int>(ceil(extent.z / cellSize)));
+		buckets.resize(static_cast<size_t>(nx) * ny * nz);
+	}
+
+	int coord(double v, double o, int n) const {
+		return std::min(n - 1, std::max(0, static_cast<int>(floor((v - o) / cellSize))));
+	}
+
+	// f(bucket) for every bucket overlapping the box [a, b]
+	template <typename F> void forEachBucket(const Vec &a, const Vec &b, const F &f) {
+		for (int i = coord(a.x, origin.x, nx); i <= coord(b.x, origin.x, nx); ++i)
+			for (int j = coord(a.y, origin.y, ny); j <= coord(b.y, origin.y, ny); ++j)
+				for (int k = coord(a.z, origin.z, nz); k <= coord(b.z, origin.z, nz); ++k)
+					f(buckets[(static_cast<size_t>(i) * ny + j) * nz + k]);
+	}
+
+	void insert(size_t face, const Vec &a, const Vec &b) {
+		forEachBucket(a, b, [face](std::vector<size_t> &bucket) { bucket.push_back(face); });
+	}
+};
+
+// isInsideModel and distanceToModel >= d, with the exact tests only run on the faces
+// that can pass them:
+// - a ray can only hit the faces whose projection on the plane normal to its direction
+//   contains the projection of its origin: faces are bucketed by the bounding box of
+//   their projection (2D grid) and a ray only tests the faces of one bucket
+// - faces closer than d to p overlap the box of half size d around p: faces are also
+//   bucketed by their bounding box (3D grid), like the modelGrid of BasicWorld
+class ModelFaceIndex {
+	const Model &m;
+	Vec dir, u, v; // ray direction and basis of the plane normal to it
+	double cellSize;
+	FaceBuckets projected, boxes;
+	std::vector<unsigned int> lastQuery; // per face, to only test a face once per query
+	unsigned int nbQueries = 0;
+
+	Vec project(const Vec &p) const { return Vec(p.dot(u), p.dot(v), 0); }
+
+	template <typename F> void faceBounds(size_t f, const F &transform, Vec &a, Vec &b) {
+		const Triangle &t = m.data->obj.faces[f];
+		a = b = transform(m.vertices[t.indices[0]]);
+		for (int i = 1; i < 3; ++i) {
+			Vec p = transform(m.vertices[t.indices[i]]);
+			a = Vec(std::min(a.x, p.x), std::min(a.y, p.y), std::min(a.z, p.z));
+			b = Vec(std::max(b.x, p.x), std::max(b.y, p.y), std::max(b.z, p.z));
+		}
+	}
+
+	// the buckets are about the size of the faces, with about one bucket per face
+	static double bucketSize(const Model &m, const Vec &minCorner, const Vec &maxCorner) {
+		const size_t n = std::max<size_t>(1, m.data->obj.faces.size());
+		double faceSize = 0;
+		for (const auto &t : m.data->obj.faces)
+			for (int i = 0; i < 3; ++i) {
+				const Vec &a = m.vertices[t.indices[i]], &b = m.vertices[t.indices[(i + 1) % 3]];
+				faceSize += (b - a).length();
+			}
+		faceSize /= 3.0 * n;
+		Vec extent = maxCorner - minCorner;
+		double volume = std::max<double>(extent.x, 1e-9) * std::max<double>(extent.y, 1e-9) *
+		                std::max<double>(extent.z, 1e-9);
+		return std::max(faceSize, cbrt(volume / n));
+	}
+
+	static FaceBuckets projectedBuckets(const Model &m, const Vec &u, const Vec &v,
+	                                    double cs) {
+		const double inf = std::numeric_limits<double>::infinity();
+		Vec a(inf, inf, 0), b(-inf, -inf, 0);
+		for (const auto &p : m.vertices) {
+			double pu = p.dot(u), pv = p.dot(v);
+			a = Vec(std::min<double>(a.x, pu), std::min<double>(a.y, pv), 0);
+			b = Vec(std::max<double>(b.x, pu), std::max<double>(b.y, pv), 0);
+		}
+		return FaceBuckets(a, b, cs);
+	}
+
+public:
+	ModelFaceIndex(const Model &model, const Vec &minCorner, const Vec &maxCorner)
+	    : m(model),
+	      dir(insideRayDirection()),
+	      u(dir.ortho().normalized()),
+	      v(dir.cross(u)),
+	      cellSize(bucketSize(m, minCorner, maxCorner)),
+	      projected(projectedBuckets(m, u, v, cellSize)),
+	      boxes(minCorner, maxCorner, cellSize),
+	      lastQuery(m.data->obj.faces.size(), 0) {
+		auto identity = [](const Vec &p) { return p; };
+		auto projection = [this](const Vec &p) { return project(p); };
+		for (size_t f = 0; f < m.data->obj.faces.size(); ++f) {
+			Vec a, b;
+			faceBounds(f, projection, a, b);
+			projected.insert(f, a, b);
+			faceBounds(f, identity, a, b);
+			boxes.insert(f, a, b);
+		}
+	}
+
+	bool isInside(const Vec &p) {
+		Vec q = project(p);
+		int nbHits = 0;
+		projected.forEachBucket(q, q, [&](const std::vector<size_t> &bucket) {
+			for (size_t f : bucket)
+				if (rayHitsFace(m, f, p, dir)) ++nbHits;
+		});
+		return nbHits % 2 == 1;
+	}
+
+	bool fartherThan(const Vec &p, double d) {
+		if (++nbQueries == 0) {
+			std::fill(lastQuery.begin(), lastQuery.end(), 0);
+			nbQueries = 1;
+		}
+		bool res = true;
+		boxes.forEachBucket(p - Vec(d), p + Vec(d), [&](const std::vector<size_t> &bucket) {
+			for (size_t i = 0; i < bucket.size() && res; ++i) {
+				size_t f = bucket[i];
+				if (lastQuery[f] == nbQueries) continue;
+				lastQuery[f] = nbQueries;
+				if (distanceToFace(m, f, p) < d) res = false;
+			}
+		});
+		return res;
+	}
+};
+
+std::vector<Vec> poissonDiskInModel(const Model &m, double minDist, double margin,
+                                    int nbAttempts, std::default_random_engine &rng) {
+	std::vector<Vec> res;
+	Vec minCorner, maxCorner;
+	modelBounds(m, minCorner, maxCorner);
+	if (m.vertices.empty()) return res;
+	SampleGrid grid(minCorner, maxCorner, minDist);
+	ModelFaceIndex faces(m, minCorner, maxCorner);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::normal_distribution<double> normal;
+	auto valid = [&](const Vec &p) {
+		return inBox(p, minCorner, maxCorner) && grid.farEnough(p, res, minDist) &&
+		       faces.isInside(p) && (margin <= 0 || faces.fartherThan(p, margin));
+	};
+	auto accept = [&](const Vec &p, std::vector<int> &active) {
+		grid.insert(p, res.size());
+		active.push_back(res.size());
+		res.push_back(p);
+	};
+	Vec extent = maxCorner - minCorner;
+	std::vector<int> active;
+	while (true) {
+		// new seed (several disconnected regions can be filled this way)
+		bool seeded = false;
+		for (int a = 0; a < nbAttempts * 10 && !seeded; ++a) {
+			Vec p = minCorner + Vec(unit(rng) * extent.x, unit(rng) * extent.y,
+			                        unit(rng) * extent.z);
+			if (valid(p)) {
+				accept(p, active);
+				seeded = true;
+			}
+		}
+		if (!seeded) break;
+		while (!active.empty()) {
+			size_t i = std::uniform_int_distribution<size_t>(0, active.size() - 1)(rng);
+			Vec center = res[active[i]];
+			bool found = false;
+			for (int a = 0; a < nbAttempts; ++a) {
+				// uniform in the spherical shell [minDist, 2 minDist]
+				double r = minDist * cbrt(1.0 + 7.0 * unit(rng));
+				Vec dir(normal(rng), normal(rng), normal(rng));
+				Vec p = center + r * dir.normalized();
+				if (valid(p)) {
+					accept(p, active);
+					found = true;
+					break;
+				}
+			}
+			if (!found) {
+				active[i] = active.back();
+				active.pop_back();
+			}
+		}
+	}
+	return res;
+}
+
+std::vector<Vec> surfaceMonolayer(const Model &m, double minDist, double offset,
+                                  int nbAttempts, std::default_random_engine &rng) {
+	std::vector<Vec> res;
+	const auto &faces = m.data->obj.faces;
+	if (faces.empty()) return res;
+	std::vector<double> cumulatedArea;
+	double area = 0;
+	for (const auto &f : faces) {
+		const Vec &v0 = m.vertices[f.indices[0]], &v1 = m.vertices[f.indices[1]],
+		          &v2 = m.vertices[f.indices[2]];
+		area += 0.5 * (v1 - v0).cross(v2 - v0).length();
+		cumulatedArea.push_back(area);
+	}
+	Vec minCorner, maxCorner;
+	modelBounds(m, minCorner, maxCorner);
+	minCorner = minCorner - fabs(offset);
+	maxCorner = maxCorner + fabs(offset);
+	SampleGrid grid(minCorner, maxCorner, minDist);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	// dart throwing: nbAttempts times the number of disks the surface could hold
+	const size_t nbDarts = nbAttempts * static_cast<size_t>(area / (minDist * minDist) + 1);
+	for (size_t a = 0; a < nbDarts; ++a) {
+		size_t f = std::upper_bound(cumulatedArea.begin(), cumulatedArea.end(),
+		                            unit(rng) * area) -
+		           cumulatedArea.begin();
+		f = std::min(f, faces.size() - 1);
+		const Vec &v0 = m.vertices[faces[f].indices[0]], &v1 = m.vertices[faces[f].indices[1]],
+		          &v2 = m.vertices[faces[f].indices[2]];
+		// uniform in the triangle
+		double s = sqrt(unit(rng)), t = unit(rng);
+		Vec n = (v1 - v0).cross(v2 - v0).normalized();
+		Vec p = (1.0 - s) * v0 + s * (1.0 - t) * v1 + s * t * v2 + offset * n;
+		if (grid.farEnough(p, res, minDist)) {
+			grid.insert(p, res.size());
+			res.push_back(p);
+		}
+	}
+	return res;
+}
+}
@@ -0,0 +1,48 @@
+#ifndef MECACELL_GENERATORS_H
+#define MECACELL_GENERATORS_H
+#include <random>
+#include <vector>
+#include "model.h"
+#include "tools.h"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                  INITIAL CONFIGURATIONS
+////////////////////////////////////////////////////////////////////
+// Generators of packed initial positions, meant to be fed to BasicWorld::addCells, which
+// connects the cells in contact right away. Each generator bounds how close neighbours
+// can get: exactly spacing apart for hexagonalClosePacking, at least minDist for the
+// Poisson disk and monolayer samplers, at least (1 - 2 * jitter) * spacing for
+// jitteredLattice. With a distance close to the rest length of the connections (see
+// ConnectableCell::getConnectionLength) the tissue starts near equilibrium instead of
+// spending thousands of steps relaxing randomly placed cells. Two cells of radius r are
+// only connected when their centers are less than 2r apart.
+
+// hexagonal close packing filling the box, neighbours are exactly spacing apart
+std::vector<Vec> hexagonalClosePacking(const Vec &minCorner, const Vec &maxCorner,
+                                       double spacing);
+
+// cubic lattice filling the box, each position moved by up to jitter * spacing along each
+// axis (neighbours stay at least (1 - 2 * jitter) * spacing apart)
+std::vector<Vec> jitteredLattice(const Vec &minCorner, const Vec &maxCorner,
+                                 double spacing, double jitter,
+                                 std::default_random_engine &rng = globalRand);
+
+// Poisson disk sampling (Bridson) of the volume enclosed by a closed model: points are
+// at least minDist apart and at least margin away from the model's surface
+std::vector<Vec> poissonDiskInModel(const Model &m, double minDist, double margin = 0,
+                                    int nbAttempts = 30,
+                                    std::default_random_engine &rng = globalRand);
+
+// single layer of points at least minDist apart on the surface of a model, moved by
+// offset along the faces normals (typically the cells radius, so that they lie on the
+// surface). Faces are sampled proportionally to their area
+std::vector<Vec> surfaceMonolayer(const Model &m, double minDist, double offset,
+                                  int nbAttempts = 30,
+                                  std::default_random_engine &rng = globalRand);
+
+// inside test by ray casting (the model must be closed)
+bool isInsideModel(const Model &m, const Vec &p);
+double distanceToModel(const Model &m, const Vec &p);
+}
+#endif
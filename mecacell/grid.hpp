@@ -11,18 +11,18 @@ using namespace std;
 namespace MecaCell {
 template <typename O> class Grid {
 private:
-	double cellSize; // actually it's 1/cellSize, just so we can multiply
+	num_t cellSize; // actually it's 1/cellSize, just so we can multiply
 	unordered_map<Vec, vector<O>> um;
 
 public:
-	Grid(double cs) : cellSize(1.0 / cs) {}
+	Grid(num_t cs) : cellSize(1.0 / cs) {}
 
-	double getCellSize() const { return 1.0 / cellSize; }
+	num_t getCellSize() const { return 1.0 / cellSize; }
 	const unordered_map<Vec, vector<O>> &getContent() const { return um; }
 
 	void insert(const O &obj) {
 		Vec center = ptr(obj)->getPosition() * cellSize;
-		double radius = ptr(obj)->getRadius() * cellSize;
+		num_t radius = ptr(obj)->getRadius() * cellSize;
 		Vec minCorner = center - radius;
 		Vec maxCorner = center + radius;
 		minCorner.iterateTo(maxCorner, [&](Vec v) { um[v].push_back(obj); });
@@ -34,7 +34,7 @@ public:
 		        min(p0.z, min(p1.z, p2.z)));
 		Vec trb(max(p0.x, max(p1.x, p2.x)), max(p0.y, max(p1.y, p2.y)),
 		        max(p0.z, max(p1.z, p2.z)));
-		double cs = 1.0 / cellSize;
+		num_t cs = 1.0 / cellSize;
 		getIndexFromPosition(blf).iterateTo(getIndexFromPosition(trb) + 1, [&](const Vec &v) {
 			Vec center = cs * v;
 			std::pair<bool, Vec> projec = projectionIntriangle(p0, p1, p2, center);
@@ -51,10 +51,10 @@ public:
 		return Vec(floor(res.x), floor(res.y), floor(res.z));
 	}
 
-	set<O> retrieveUnique(const Vec &coord, double r) const {
+	set<O> retrieveUnique(const Vec &coord, num_t r) const {
 		set<O> res;
 		Vec center = coord * cellSize;
-		double radius = r * cellSize;
+		num_t radius = r * cellSize;
 		Vec minCorner = center - radius;
 		Vec maxCorner = center + radius;
 		// TODO check if faster with a set (uniques...) and by removing  selfcollision
@@ -68,10 +68,10 @@ public:
 		return res;
 	}
 
-	vector<O> retrieve(const Vec &coord, double r) const {
+	vector<O> retrieve(const Vec &coord, num_t r) const {
 		vector<O> res;
 		Vec center = coord * cellSize;
-		double radius = r * cellSize;
+		num_t radius = r * cellSize;
 		Vec minCorner = center - radius;
 		Vec maxCorner = center + radius;
 		// TODO check if faster with a set (uniques...) and by removing  selfcollision
@@ -84,7 +84,7 @@ public:
 	vector<O> retrieve(const O &obj) const {
 		vector<O> res;
 		Vec center = ptr(obj)->getPosition() * cellSize;
-		double radius = ptr(obj)->getRadius() * cellSize;
+		num_t radius = ptr(obj)->getRadius() * cellSize;
 		Vec minCorner = center - radius;
 		Vec maxCorner = center + radius;
 		minCorner.iterateTo(maxCorner, [this, &res](const Vec &v) {
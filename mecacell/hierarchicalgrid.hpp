@@ -0,0 +1,69 @@
+#ifndef MECACELL_HIERARCHICALGRID_HPP
+#define MECACELL_HIERARCHICALGRID_HPP
+#include <vector>
+#include "flatgrid.hpp"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                     HIERARCHICAL GRID
+////////////////////////////////////////////////////////////////////
+// Stack of FlatGrids whose cell sizes double from one level to the next. Each object is
+// only inserted in the first level whose cell size is at least its diameter, where it
+// overlaps at most 2 buckets along each axis, and queries visit every non empty level.
+// Very large objects (cysts, oocytes...) thus no longer fill hundreds of buckets and the
+// buckets of small objects are not crowded by them: memory stays linear in the number of
+// objects and candidates come from buckets sized for their own level.
+// Objects that fit in the base level see exactly the candidates of a single FlatGrid.
+template <typename O> class HierarchicalGrid {
+	num_t baseCellSize;
+	std::vector<FlatGrid<O>> levels;
+	std::vector<std::vector<O>> levelObjects;
+
+public:
+	HierarchicalGrid(num_t cs) : baseCellSize(cs) {}
+
+	num_t getCellSize() const { return baseCellSize; }
+	size_t getNbLevels() const { return levels.size(); }
+	const FlatGrid<O> &getLevel(size_t l) const { return levels[l]; }
+	size_t getNbEntries() const {
+		size_t n = 0;
+		for (const auto &l : levels) n += l.getNbEntries();
+		return n;
+	}
+
+	size_t levelOf(num_t radius) const {
+		size_t l = 0;
+		for (num_t cs = baseCellSize; cs < 2 * radius; cs *= 2) ++l;
+		return l;
+	}
+
+	// rebuilds the levels from objects, with the workers of pool (serial if null)
+	void build(const std::vector<O> &objs, WorkStealingPool *pool = nullptr) {
+		for (auto &o : levelObjects) o.clear();
+		for (const auto &o : objs) {
+			size_t l = levelOf(ptr(o)->getRadius());
+			if (l >= levelObjects.size()) levelObjects.resize(l + 1);
+			levelObjects[l].push_back(o);
+		}
+		while (levels.size() < levelObjects.size()) {
+			num_t cs = baseCellSize * static_cast<num_t>(1 << levels.size());
+			levels.push_back(FlatGrid<O>(cs));
+		}
+		for (size_t l = 0; l < levels.size(); ++l) levels[l].build(levelObjects[l], pool);
+	}
+
+	void clear() {
+		for (auto &l : levels) l.clear();
+	}
+
+	std::vector<O> retrieve(const Vec &coord, num_t r) const {
+		std::vector<O> res;
+		for (const auto &l : levels) l.retrieve(coord, r, res);
+		return res;
+	}
+	std::vector<O> retrieve(const O &obj) const {
+		return retrieve(ptr(obj)->getPosition(), ptr(obj)->getRadius());
+	}
+};
+}
+#endif
@@ -1,5 +1,12 @@
 #ifndef INTEGRATORS_HPP
 #define INTEGRATORS_HPP
+#include <cmath>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "connection.h"
+#include "tools.h"
 
 // Integration schemes
 // using structs instead of lambda templates (c++14 feature :-/ )
@@ -8,7 +15,7 @@ namespace MecaCell {
 struct Verlet {
 	template <typename C> void operator()(C &c, const double &dt) {
 
-		if (c.isMovementEnabled()) {
+		if (c.isMovementEnabled() && !c.isSleeping()) {
 			// position
 			auto oldVel = c.getVelocity();
 			c.setVelocity(c.getVelocity() + c.getForce() * dt / c.getMass());
@@ -19,8 +26,7 @@ struct Verlet {
 			oldVel = c.getAngularVelocity();
 			c.setAngularVelocity(c.getAngularVelocity() +
 			                     c.getTorque() * dt / c.getMomentOfInertia());
-			c.setOrientationRotation(c.getOrientationRotation() +
-			                         (c.getAngularVelocity() + oldVel) * dt * 0.5);
+			c.addAngularDisplacement((c.getAngularVelocity() + oldVel) * dt * 0.5);
 			c.updateCurrentOrientation();
 		}
 	}
@@ -28,7 +34,7 @@ struct Verlet {
 struct Euler {
 	template <typename C> void operator()(C &c, const double &dt) {
 
-		if (c.isMovementEnabled()) {
+		if (c.isMovementEnabled() && !c.isSleeping()) {
 			// position
 			c.setVelocity(c.getVelocity() + c.getForce() * dt / c.getMass());
 			c.setPrevposition(c.getPosition());
@@ -37,10 +43,154 @@ struct Euler {
 			// orientation
 			c.setAngularVelocity(c.getAngularVelocity() +
 			                     c.getTorque() * dt / c.getMomentOfInertia());
-			c.setOrientationRotation(c.getOrientationRotation() + c.getAngularVelocity() * dt);
+			c.addAngularDisplacement(c.getAngularVelocity() * dt);
 			c.updateCurrentOrientation();
 		}
 	}
 };
+
+// Linearly implicit (backward) Euler for the translational part (Baraff & Witkin):
+// (M + dt.C + dt².K) dv = dt.(f - dt.K.v)
+// where K and C are the stiffness and damping matrices of the cell-cell springs (axial
+// terms only, so that the system stays symmetric positive definite). The system is
+// solved with a Jacobi preconditioned conjugate gradient over the connection graph.
+// Forces that are not part of the system (joints, models, friction, gravity) stay
+// explicit, and so does the orientation. Stable with time steps far larger than what
+// Euler or Verlet tolerate for stiff cells.
+struct ImplicitEuler {
+	int maxIterations = 100;
+	double tolerance = 1e-6; // relative residual
+
+	// solver buffers, kept between updates to avoid reallocations
+	std::vector<Vec> b, x, r, z, p, Ap, diag;
+	std::vector<double> mass;
+	std::vector<char> fixed;
+	// enabled springs: indices of their nodes, coefficient and direction
+	std::vector<std::pair<size_t, size_t>> ends;
+	std::vector<double> coefs;
+	std::vector<Vec> dirs;
+
+	// orientation only, positions are handled by integrate
+	template <typename C> void operator()(C &c, const double &dt) {
+		if (c.isMovementEnabled() && !c.isSleeping()) {
+			c.setAngularVelocity(c.getAngularVelocity() +
+			                     c.getTorque() * dt / c.getMomentOfInertia());
+			c.addAngularDisplacement(c.getAngularVelocity() * dt);
+			c.updateCurrentOrientation();
+		}
+	}
+
+	template <typename Cell, typename Connect>
+	void integrate(std::vector<Cell *> &cells, std::vector<Connect *> &connections,
+	               const double &dt) {
+		const size_t n = cells.size();
+		std::unordered_map<Cell *, size_t> id;
+		id.reserve(n);
+		for (size_t i = 0; i < n; ++i) id[cells[i]] = i;
+		b.assign(n, Vec::zero());
+		x.assign(n, Vec::zero());
+		diag.assign(n, Vec::zero());
+		mass.resize(n);
+		fixed.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			fixed[i] = !cells[i]->isMovementEnabled() || cells[i]->isSleeping();
+			mass[i] = cells[i]->getMass();
+			b[i] = cells[i]->getForce() * dt;
+			diag[i] = Vec(mass[i]);
+		}
+		// node indices are looked up once per step, the CG products then only use ends
+		// per spring: a = dt.c' + dt².k' (coefficient of d.dT in the system matrix)
+		ends.clear();
+		coefs.clear();
+		dirs.clear();
+		for (auto &c : connections) {
+			if (!c->scEnabled) continue;
+			size_t i = id.at(c->getNode0()), j = id.at(c->getNode1());
+			const Spring &s = c->getSc();
+			const Vec &d = s.direction;
+			double a = dt * s.c * 0.5 + dt * dt * s.k * 0.5;
+			ends.push_back(std::make_pair(i, j));
+			coefs.push_back(a);
+			dirs.push_back(d);
+			Vec dd(d.x * d.x, d.y * d.y, d.z * d.z);
+			diag[i] += a * dd;
+			diag[j] += a * dd;
+			// -dt².K.v
+			Vec relativeVelocity = cells[i]->getVelocity() - cells[j]->getVelocity();
+			Vec kv = (dt * dt * s.k * 0.5 * d.dot(relativeVelocity)) * d;
+			b[i] += -1.0 * kv;
+			b[j] += kv;
+		}
+		for (size_t i = 0; i < n; ++i)
+			if (fixed[i]) b[i] = Vec::zero();
+
+		auto product = [&](const std::vector<Vec> &in, std::vector<Vec> &out) {
+			for (size_t i = 0; i < n; ++i) out[i] = fixed[i] ? Vec::zero() : in[i] * mass[i];
+			for (size_t e = 0; e < ends.size(); ++e) {
+				size_t i = ends[e].first, j = ends[e].second;
+				const Vec &d = dirs[e];
+				Vec f = (coefs[e] * d.dot(in[i] - in[j])) * d;
+				if (!fixed[i]) out[i] += f;
+				if (!fixed[j]) out[j] += -1.0 * f;
+			}
+		};
+		auto dot = [&](const std::vector<Vec> &u, const std::vector<Vec> &v) {
+			double res = 0;
+			for (size_t i = 0; i < n; ++i) res += u[i].dot(v[i]);
+			return res;
+		};
+
+		// preconditioned conjugate gradient, starting from dv = 0
+		r = b;
+		z.resize(n);
+		Ap.resize(n);
+		for (size_t i = 0; i < n; ++i) z[i] = r[i] / diag[i];
+		p = z;
+		double rz = dot(r, z);
+		double threshold = tolerance * tolerance * dot(b, b);
+		for (int it = 0; it < maxIterations && rz > 0 && dot(r, r) > threshold; ++it) {
+			product(p, Ap);
+			double pAp = dot(p, Ap);
+			if (pAp <= 0) break;
+			double alpha = rz / pAp;
+			for (size_t i = 0; i < n; ++i) {
+				x[i] += alpha * p[i];
+				r[i] += -alpha * Ap[i];
+				z[i] = r[i] / diag[i];
+			}
+			double rzNew = dot(r, z);
+			for (size_t i = 0; i < n; ++i) p[i] = z[i] + (rzNew / rz) * p[i];
+			rz = rzNew;
+		}
+
+		for (size_t i = 0; i < n; ++i) {
+			Cell *c = cells[i];
+			if (!fixed[i]) {
+				c->setVelocity(c->getVelocity() + x[i]);
+				c->setPrevposition(c->getPosition());
+				c->setPosition(c->getPosition() + c->getVelocity() * dt);
+			}
+			(*this)(*c, dt);
+		}
+	}
+};
+
+// integrates all the cells of a world. Integrators without an integrate method are
+// applied independently to each cell
+template <typename I, typename Cell, typename Connect>
+void integrateAll(I &integrator, std::vector<Cell *> &cells, std::vector<Connect *> &,
+                  const double &dt) {
+	for (auto &c : cells) integrator(*c, dt);
+}
+template <typename Cell, typename Connect>
+void integrateAll(ImplicitEuler &integrator, std::vector<Cell *> &cells,
+                  std::vector<Connect *> &connections, const double &dt) {
+	integrator.integrate(cells, connections, dt);
+}
+
+// integrators whose operator() only modifies the integrated cell can be run on several
+// cells concurrently
+template <typename I> struct IsCellLocal : std::true_type {};
+template <> struct IsCellLocal<ImplicitEuler> : std::false_type {};
 }
 #endif
@@ -0,0 +1,42 @@
+#ifndef MATRIX3X3_H
+#define MATRIX3X3_H
+#include <array>
+#include "quaternion.h"
+
+namespace MecaCell {
+
+using std::array;
+// rotation matrix, used to cache an orientation so that many vectors can be rotated
+// without recomposing quaternions (see Orientable::getOrientationMatrix)
+struct Matrix3x3 {
+	array<Vector3D, 3> rows = {{Vector3D(1, 0, 0), Vector3D(0, 1, 0), Vector3D(0, 0, 1)}};
+	Matrix3x3() {}
+	// q must be a unit quaternion
+	explicit Matrix3x3(const Quaternion &q) {
+		const double x = q.v.x, y = q.v.y, z = q.v.z, w = q.w;
+		rows[0] = Vector3D(1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y - w * z),
+		                   2.0 * (x * z + w * y));
+		rows[1] = Vector3D(2.0 * (x * y + w * z), 1.0 - 2.0 * (x * x + z * z),
+		                   2.0 * (y * z - w * x));
+		rows[2] = Vector3D(2.0 * (x * z - w * y), 2.0 * (y * z + w * x),
+		                   1.0 - 2.0 * (x * x + y * y));
+	}
+	Vector3D column(size_t i) const {
+		return Vector3D(i == 0 ? rows[0].x : i == 1 ? rows[0].y : rows[0].z,
+		                i == 0 ? rows[1].x : i == 1 ? rows[1].y : rows[1].z,
+		                i == 0 ? rows[2].x : i == 1 ? rows[2].y : rows[2].z);
+	}
+	Vector3D operator*(const Vector3D &v) const {
+		return Vector3D(rows[0].x * v.x + rows[0].y * v.y + rows[0].z * v.z,
+		                rows[1].x * v.x + rows[1].y * v.y + rows[1].z * v.z,
+		                rows[2].x * v.x + rows[2].y * v.y + rows[2].z * v.z);
+	}
+	// transpose(M) * v, i.e. the inverse rotation
+	Vector3D transposedProduct(const Vector3D &v) const {
+		return Vector3D(rows[0].x * v.x + rows[1].x * v.y + rows[2].x * v.z,
+		                rows[0].y * v.x + rows[1].y * v.y + rows[2].y * v.z,
+		                rows[0].z * v.x + rows[1].z * v.y + rows[2].z * v.z);
+	}
+};
+}
+#endif
@@ -9,4 +9,7 @@
 #include "integrators.hpp"
 #include "connectablecell.hpp"
 #include "basicworld.hpp"
+#include "ensemble.hpp"
+#include "distributedworld.hpp"
+#include "generators.h"
 #endif
@@ -1,4 +1,5 @@
 #include "model.h"
+#include <algorithm>
 
 using std::string;
 using std::vector;
@@ -6,12 +7,49 @@ using std::unordered_map;
 using std::unordered_set;
 
 namespace MecaCell {
-Model::Model(const string &filepath) : obj(filepath) {
-	updateFacesFromObj();
-	// computeAdjacency();
-	updateFromTransformation();
+ModelData::ModelData(const string &filepath) : obj(filepath) { computeAdjacency(); }
+ModelData::ModelData(std::istream &in) : obj(in) { computeAdjacency(); }
+
+// O(F) adjacency: we first build the vertex -> faces incidence table (also in CSR
+// form) and then merge the incidence lists of the 3 vertices of each face.
+void ModelData::computeAdjacency() {
+	const vector<Triangle> &faces = obj.faces;
+	size_t nbVertices = obj.vertices.size();
+	for (const auto &t : faces)
+		for (const auto &v : t.indices) nbVertices = std::max<size_t>(nbVertices, v + 1);
+
+	// vertex -> faces
+	vector<unsigned int> incidenceOffsets(nbVertices + 1, 0);
+	for (const auto &t : faces)
+		for (const auto &v : t.indices) ++incidenceOffsets[v + 1];
+	for (size_t v = 0; v < nbVertices; ++v) incidenceOffsets[v + 1] += incidenceOffsets[v];
+	vector<unsigned int> incidence(incidenceOffsets.back());
+	vector<unsigned int> cursor(incidenceOffsets.begin(), incidenceOffsets.end() - 1);
+	for (size_t f = 0; f < faces.size(); ++f)
+		for (const auto &v : faces[f].indices) incidence[cursor[v]++] = f;
+
+	// face -> faces
+	adjacencyOffsets.assign(faces.size() + 1, 0);
+	adjacency.clear();
+	adjacency.reserve(incidence.size() * 4);
+	vector<unsigned int> neighbours;
+	for (size_t f = 0; f < faces.size(); ++f) {
+		neighbours.clear();
+		for (const auto &v : faces[f].indices)
+			neighbours.insert(neighbours.end(), incidence.begin() + incidenceOffsets[v],
+			                  incidence.begin() + incidenceOffsets[v + 1]);
+		std::sort(neighbours.begin(), neighbours.end());
+		auto last = std::unique(neighbours.begin(), neighbours.end());
+		for (auto it = neighbours.begin(); it != last; ++it)
+			if (*it != f) adjacency.push_back(*it);
+		adjacencyOffsets[f + 1] = adjacency.size();
+	}
+	adjacency.shrink_to_fit();
 }
 
+Model::Model(const string &filepath) : Model(std::make_shared<const ModelData>(filepath)) {}
+Model::Model(const shared_ptr<const ModelData> &d) : data(d) { updateFromTransformation(); }
+
 void Model::scale(const Vec &s) {
 	transformation.scale(s);
 	updateFromTransformation();
@@ -34,34 +72,12 @@ bool Model::changedSinceLastCheck() {
 void Model::updateFromTransformation() {
 	vertices.clear();
 	normals.clear();
-	for (auto &v : obj.vertices) {
+	for (auto &v : data->obj.vertices) {
 		vertices.push_back(transformation * v);
 	}
-	for (auto &n : obj.normals) {
+	for (auto &n : data->obj.normals) {
 		normals.push_back((transformation * n).normalized());
 	}
 	changed = true;
 }
-void Model::updateFacesFromObj() {
-	for (auto &f : obj.faces) {
-		faces.push_back(f.at("v"));
-	}
-	changed = true;
-}
-void Model::computeAdjacency() {
-	for (size_t i = 0; i < faces.size(); ++i) {
-		Triangle &ti = faces[i];
-		for (size_t j = i + 1; j < faces.size(); ++j) {
-			Triangle &tj = faces[j];
-			if (ti.indices[0] == tj.indices[0] || ti.indices[0] == tj.indices[1] ||
-			    ti.indices[0] == tj.indices[2] || ti.indices[1] == tj.indices[0] ||
-			    ti.indices[1] == tj.indices[1] || ti.indices[1] == tj.indices[2] ||
-			    ti.indices[2] == tj.indices[0] || ti.indices[2] == tj.indices[1] ||
-			    ti.indices[2] == tj.indices[2]) {
-				adjacency[i].insert(j);
-				adjacency[j].insert(i);
-			}
-		}
-	}
-}
 }
@@ -3,6 +3,7 @@
 #include "matrix4x4.h"
 #include "objmodel.h"
 #include "tools.h"
+#include <memory>
 #include <vector>
 #include <string>
 #include <vector>
@@ -14,29 +15,51 @@ using std::vector;
 using std::unordered_map;
 using std::unordered_set;
 using std::pair;
+using std::shared_ptr;
 
 namespace MecaCell {
 
-struct Model;
+// Immutable mesh data (parsed obj, faces, adjacency). It is meant to be loaded once and
+// shared (through a shared_ptr<const ModelData>) by all the Model instances using the
+// same geometry, whatever world they belong to.
+struct ModelData {
+	ModelData(const string &filepath);
 
+	ModelData(std::istream &in);
+
+	void computeAdjacency();
+	size_t getNbAdjacentFaces(size_t f) const {
+		return adjacencyOffsets[f + 1] - adjacencyOffsets[f];
+	}
+	// i-th face adjacent to face f
+	unsigned int getAdjacentFace(size_t f, size_t i) const {
+		return adjacency[adjacencyOffsets[f] + i];
+	}
+
+	ObjModel obj; // faces are in obj.faces
+	// adjacent faces share at least one vertex. Compressed (CSR) layout: the faces adjacent
+	// to face f are stored in adjacency[adjacencyOffsets[f]] to
+	// adjacency[adjacencyOffsets[f + 1] - 1]
+	vector<unsigned int> adjacencyOffsets;
+	vector<unsigned int> adjacency;
+};
+
+// A model instance: shared geometry + its own transformation and transformed vertices
 struct Model {
 	Model(const string &filepath);
+	Model(const shared_ptr<const ModelData> &d);
 
 	void scale(const Vec &s);
 	void translate(const Vec &t);
 	void rotate(const Rotation<Vec> &r);
 	void updateFromTransformation();
-	void computeAdjacency();
-	void updateFacesFromObj();
 	bool changedSinceLastCheck();
 
 	string name;
-	ObjModel obj;
+	shared_ptr<const ModelData> data;
 	Matrix4x4 transformation;
 	vector<Vec> vertices;
 	vector<Vec> normals;
-	vector<Triangle> faces;
-	unordered_map<size_t, unordered_set<size_t>> adjacency; // adjacent faces share at least one vertex
 	bool changed = true;
 };
 }
@@ -30,6 +30,8 @@ struct SpaceConnectionPoint { // just a connection point with anything anywhere
 	Vec getAngularVelocity() { return Vec::zero(); }
 	Basis<Vec> getOrientation() { return Basis<Vec>(); }
 	Rotation<Vec> getOrientationRotation() { return Rotation<Vec>(); }
+	Quaternion getOrientationQuaternion() { return Quaternion(); }
+	Matrix3x3 getOrientationMatrix() { return Matrix3x3(); }
 	double getInertia() { return 1; }
 	void receiveForce(double, const Vec &, bool) {}
 	void receiveForce(const Vec &) {}
@@ -49,29 +51,47 @@ struct ModelConnectionPoint {
 	Vec getAngularVelocity() { return Vec::zero(); }
 	Basis<Vec> getOrientation() { return Basis<Vec>(); }
 	Rotation<Vec> getOrientationRotation() { return Rotation<Vec>(); }
+	Quaternion getOrientationQuaternion() { return Quaternion(); }
+	Matrix3x3 getOrientationMatrix() { return Matrix3x3(); }
 	double getInertia() { return 1; }
 	void receiveForce(double, const Vec &, bool) {}
 	void receiveForce(const Vec &) {}
 	void receiveTorque(const Vec &) {}
 };
 
+// Contact between a cell and the surface of a model. Only springs are involved, so
+// instead of 2 full Connection objects (and their unused joints) a contact just stores
+// its 2 end points and 2 springs. Contacts are stored by value, per (model, cell) pair.
+// - bounce: from the projection of the cell on the model, always perpendicular to the
+//   face, rest length < radius
+// - anchor: 0 rest length spring from a point that slides along with the cell (at the
+//   cell's height), resisting tangential motion
 template <typename Cell> struct CellModelConnection {
-	using CMConnection = Connection<ModelConnectionPoint, Cell *>;
-	using CSConnection = Connection<SpaceConnectionPoint, Cell *>;
-	Model *model;
-	CSConnection anchor;  // slide and anchor, only angular
-	CMConnection bounce;  // always perpendicular, only classic spring
+	Cell *cell = nullptr;
+	ModelConnectionPoint bouncePoint = ModelConnectionPoint(nullptr, Vec::zero(), 0);
+	SpaceConnectionPoint anchorPoint = SpaceConnectionPoint(Vec::zero());
+	Spring bounce, anchor;
 	double maxTeta = 0.1; // this is for the anchor, and should always be smaller than the
 	                      // actual connection's maxTeta
+	bool dirty = false;   // does this connection need to be deleted?
 
-	void computeForces(double dt) {
-		anchor.computeForces(dt);
-		bounce.computeForces(dt);
+	CellModelConnection() {}
+	CellModelConnection(Cell *c, const ModelConnectionPoint &b, const Spring &bs,
+	                    const Spring &as)
+	    : cell(c), bouncePoint(b), anchorPoint(c->getPosition()), bounce(bs), anchor(as) {
+		bounce.updateLengthDirection(bouncePoint.position, c->getPosition());
+		bounce.prevLength = bounce.length;
+		anchor.updateLengthDirection(anchorPoint.position, c->getPosition());
+		anchor.prevLength = anchor.length;
 	}
 
-	CellModelConnection() {}
-	CellModelConnection(CSConnection a, CMConnection b) : anchor(a), bounce(b) {}
-	bool dirty = false; // does this connection need to be deleted?
+	Model *getModel() const { return bouncePoint.model; }
+	size_t getFace() const { return bouncePoint.face; }
+
+	void computeForces(double dt) {
+		computeSpringForces(anchor, &anchorPoint, cell, dt);
+		computeSpringForces(bounce, &bouncePoint, cell, dt);
+	}
 };
 }
 #endif
@@ -0,0 +1,74 @@
+#ifndef MECACELL_MORTON_HPP
+#define MECACELL_MORTON_HPP
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "tools.h"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                      MORTON (Z ORDER) CODES
+////////////////////////////////////////////////////////////////////
+// Sorting objects by the Morton code of their position lays them out along a Z order
+// space filling curve: objects close in space end up close in memory.
+
+// spreads the 21 lowest bits of v so that there are 2 zeros between each of them
+inline uint64_t spreadBits21(uint64_t v) {
+	v &= 0x1fffff;
+	v = (v | v << 32) & 0x1f00000000ffffull;
+	v = (v | v << 16) & 0x1f0000ff0000ffull;
+	v = (v | v << 8) & 0x100f00f00f00f00full;
+	v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+	v = (v | v << 2) & 0x1249249249249249ull;
+	return v;
+}
+
+inline uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+	return spreadBits21(x) | (spreadBits21(y) << 1) | (spreadBits21(z) << 2);
+}
+
+// quantizes positions inside an axis aligned box on a 2^21 wide grid
+struct MortonEncoder {
+	static constexpr double RESOLUTION = 2097151.0; // 2^21 - 1
+	Vec origin = Vec::zero();
+	double scale = 1.0;
+
+	MortonEncoder() {}
+	MortonEncoder(const Vec &minCorner, const Vec &maxCorner) : origin(minCorner) {
+		Vec extent = maxCorner - minCorner;
+		double l = std::max<double>(extent.x, std::max<double>(extent.y, extent.z));
+		scale = l > 0 ? RESOLUTION / l : 1.0;
+	}
+
+	static Vec positionOf(const Vec &p) { return p; }
+	template <typename T> static Vec positionOf(const T &o) {
+		return ptr(o)->getPosition();
+	}
+
+	// box enclosing a set of positions or the positions of a set of (pointers to) objects
+	template <typename It> static MortonEncoder fromPositions(It begin, It end) {
+		const double inf = std::numeric_limits<double>::infinity();
+		Vec minCorner(inf), maxCorner(-inf);
+		for (It it = begin; it != end; ++it) {
+			const Vec p = positionOf(*it);
+			minCorner = Vec(std::min(minCorner.x, p.x), std::min(minCorner.y, p.y),
+			                std::min(minCorner.z, p.z));
+			maxCorner = Vec(std::max(maxCorner.x, p.x), std::max(maxCorner.y, p.y),
+			                std::max(maxCorner.z, p.z));
+		}
+		if (begin == end) return MortonEncoder();
+		return MortonEncoder(minCorner, maxCorner);
+	}
+
+	uint32_t quantize(double v, double o) const {
+		const double q = (v - o) * scale, maxQ = RESOLUTION;
+		return static_cast<uint32_t>(std::min(maxQ, std::max(0.0, q)));
+	}
+
+	uint64_t operator()(const Vec &p) const {
+		return mortonCode(quantize(p.x, origin.x), quantize(p.y, origin.y),
+		                  quantize(p.z, origin.z));
+	}
+};
+}
+#endif
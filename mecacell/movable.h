@@ -13,6 +13,8 @@ protected:
 	double mass = 1.0;
 	double baseMass = 1.0;
 	double totalForce = 0;
+	bool sleeping = false; // frozen out of the mechanical updates
+	int calmSteps = 0;     // consecutive steps under the sleeping thresholds
 
 public:
 	/**********************************************
@@ -39,6 +41,20 @@ public:
 	void setForce(const Vec &f) { force = f; }
 	void setMass(const double m) { mass = m; }
 	void setBaseMass(const double m) { baseMass = m; }
+	bool isSleeping() const { return sleeping; }
+	void sleep() {
+		sleeping = true;
+		velocity = Vec::zero();
+	}
+	void wakeUp() {
+		sleeping = false;
+		calmSteps = 0;
+	}
+	// returns the number of consecutive calm steps
+	int updateCalmness(bool calm) {
+		calmSteps = calm ? calmSteps + 1 : 0;
+		return calmSteps;
+	}
 	/**********************************************
 	 *                 UPDATES
 	 **********************************************/
@@ -47,6 +63,11 @@ public:
 		totalForce += compressive ? intensity : -intensity;
 	}
 	void receiveForce(const Vec &f) { force += f; }
+	// sum of several forces, total being the sum of their signed intensities
+	void receiveForce(const Vec &f, const double &total) {
+		force += f;
+		totalForce += total;
+	}
 	void resetVelocity() { velocity = Vec::zero(); }
 	void resetForce() {
 		totalForce = 0;
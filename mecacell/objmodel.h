@@ -4,7 +4,6 @@
 #include "tools.h"
 #include <vector>
 #include <array>
-#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -12,7 +11,6 @@
 
 using std::vector;
 using std::string;
-using std::unordered_map;
 using std::array;
 
 namespace MecaCell {
@@ -29,17 +27,28 @@ struct Triangle {
 	Triangle(unsigned int I0, unsigned int I1, unsigned int I2) : indices{{I0, I1, I2}} {}
 };
 
+// Faces are stored as flat index buffers: faces[i], uvFaces[i] and normalFaces[i] are
+// respectively the position, texture coordinates and normal indices of the i-th
+// triangle. The three arrays always have the same size; indices that are missing from
+// the file (ex: "f 1//1 2//2 3//3" has no uv) are set to 0.
 class ObjModel {
 public:
 	vector<Vec> vertices;
 	vector<UV> uv;
 	vector<Vec> normals;
-	vector<unordered_map<string, Triangle>> faces;
+	vector<Triangle> faces;
+	vector<Triangle> uvFaces;
+	vector<Triangle> normalFaces;
 
 	ObjModel(const string &filepath) {
 		std::ifstream file(filepath);
+		load(file);
+	}
+	ObjModel(std::istream &in) { load(in); }
+
+	void load(std::istream &in) {
 		string line;
-		while (std::getline(file, line)) {
+		while (std::getline(in, line)) {
 			vector<string> vs = splitStr(line, ' ');
 			if (vs.size() > 1) {
 				if (vs[0] == "v" && vs.size() > 3) {
@@ -49,16 +58,18 @@ public:
 				} else if (vs[0] == "vn" && vs.size() > 3) {
 					normals.push_back(Vec(stod(vs[1]), stod(vs[2]), stod(vs[3])));
 				} else if (vs[0] == "f" && vs.size() == 4) {
-					unordered_map<string, Triangle> tf;
+					Triangle v(0, 0, 0), t(0, 0, 0), n(0, 0, 0);
 					for (size_t i = 1; i < vs.size(); ++i) {
 						vector<string> index = splitStr(vs[i], '/');
-						if (index.size() == 3) {
-							tf["v"].indices[i - 1] = stoi(index[0]) - 1;
-							if (!index[1].empty()) tf["t"].indices[i - 1] = stoi(index[1]) - 1;
-							tf["n"].indices[i - 1] = stoi(index[2]) - 1;
-						}
+						if (index.size() > 0) v.indices[i - 1] = stoi(index[0]) - 1;
+						if (index.size() > 1 && !index[1].empty())
+							t.indices[i - 1] = stoi(index[1]) - 1;
+						if (index.size() > 2 && !index[2].empty())
+							n.indices[i - 1] = stoi(index[2]) - 1;
 					}
-					faces.push_back(tf);
+					faces.push_back(v);
+					uvFaces.push_back(t);
+					normalFaces.push_back(n);
 				}
 			}
 		}
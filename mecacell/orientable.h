@@ -1,13 +1,21 @@
 #ifndef ORIENTABLE_H
 #define ORIENTABLE_H
 #include "tools.h"
+#include "quaternion.h"
+#include "matrix3x3.h"
 namespace MecaCell {
+// Orientation is stored as a unit quaternion: integrating an angular displacement is a
+// single quaternion product and the basis is obtained by rotating the unit vectors,
+// without going back and forth through axis-angle representations.
+// The corresponding rotation matrix is cached once per update (updateCurrentOrientation)
+// and used by connections to rotate their joints.
 class Orientable {
  protected:
 	Vec angularVelocity = Vec::zero();
 	Vec torque = Vec::zero();
 	Basis<Vec> orientation;
-	Rotation<Vec> orientationRotation;
+	Quaternion orientationQuaternion;
+	Matrix3x3 orientationMatrix;
 
  public:
 	/**********************************************
@@ -20,17 +28,40 @@ class Orientable {
 	 **********************************************/
 	Vec getAngularVelocity() const { return angularVelocity; }
 	Vec getTorque() const { return torque; }
-	Basis<Vec> getOrientation() const { return orientation; }
-	Rotation<Vec> getOrientationRotation() const { return orientationRotation; }
+	const Basis<Vec>& getOrientation() const { return orientation; }
+	const Quaternion& getOrientationQuaternion() const { return orientationQuaternion; }
+	const Matrix3x3& getOrientationMatrix() const { return orientationMatrix; }
+	Rotation<Vec> getOrientationRotation() const {
+		Quaternion q(orientationQuaternion);
+		return q.toAxisAngle();
+	}
 	void setAngularVelocity(const Vec& v) { angularVelocity = v; }
 	void setTorque(const Vec& t) { torque = t; }
-	void setOrientationRotation(const Rotation<Vec>& r) { orientationRotation = r; }
+	void setOrientationQuaternion(const Quaternion& q) {
+		orientationQuaternion = q;
+		updateCurrentOrientation();
+	}
+	void setOrientationRotation(const Rotation<Vec>& r) {
+		setOrientationQuaternion(Quaternion(r.teta, r.n));
+	}
 
 	/**********************************************
 	 *                  UPDATES
 	 **********************************************/
 	void receiveTorque(const Vec& t) { torque += t; }
-	void updateCurrentOrientation() { orientation.updateWithRotation(orientationRotation); }
+	// rotates the orientation by an angular displacement (axis * angle, world frame)
+	void addAngularDisplacement(const Vec& d) {
+		double teta = d.length();
+		if (teta > 0) {
+			orientationQuaternion = Quaternion(teta, d / teta) * orientationQuaternion;
+			orientationQuaternion.normalize();
+		}
+	}
+	void updateCurrentOrientation() {
+		orientationMatrix = Matrix3x3(orientationQuaternion);
+		orientation.X = orientationMatrix.column(0);
+		orientation.Y = orientationMatrix.column(1);
+	}
 	void resetTorque() { torque = Vec::zero(); }
 	void resetAngularVelocity() { angularVelocity = Vec::zero(); }
 };
@@ -1,4 +1,5 @@
 #include "quaternion.h"
+#include "fastmath.h"
 #define dispVec(v) "(" << v.x << "," << v.y << "," << v.z << ")"
 
 namespace MecaCell {
@@ -14,15 +15,15 @@ void Quaternion::normalize() {
 }
 
 Quaternion::Quaternion(const double &angle, const Vector3D &n) {
-	double halfangle = angle * 0.5;
-	w = cos(halfangle);
-	v = n * sin(halfangle);
+	double s;
+	halfAngleSinCos(angle, s, w);
+	v = n * s;
 }
 
 Quaternion::Quaternion(const Vector3D &v0, const Vector3D &v1) {
 	Vector3D v2 = v0.normalized();
 	Vector3D v3 = v1.normalized();
-	double sc = min(1.0, max(-1.0, v2.dot(v3)));
+	double sc = min<double>(1.0, max<double>(-1.0, v2.dot(v3)));
 	if (sc < -0.9999) {
 		*this = Quaternion(M_PI, v2.ortho());
 	} else {
@@ -32,11 +33,20 @@ Quaternion::Quaternion(const Vector3D &v0, const Vector3D &v1) {
 	}
 }
 
+// rotation taking b0 to b1 (X axes first, then Y axes around the new X)
+Quaternion::Quaternion(const Basis<Vector3D> &b0, const Basis<Vector3D> &b1) {
+	Quaternion q0(b0.X, b1.X);
+	Vector3D Ytmp = q0 * b0.Y;
+	*this = Quaternion(Ytmp, b1.Y) * q0;
+	normalize();
+}
+
 Rotation<Vector3D> Quaternion::toAxisAngle() {
 	normalize();
 	double s = sqrt(1.0 - w * w);
-	if (s == 0) return Rotation<Vector3D>(Vector3D(1, 0, 0), acos(w) * 2.0);
-	return Rotation<Vector3D>(v / s, acos(w) * 2.0);
+	double angle = angleFromHalfSinCos(v.length(), w);
+	if (s == 0) return Rotation<Vector3D>(Vector3D(1, 0, 0), angle);
+	return Rotation<Vector3D>(v / s, angle);
 }
 
 double Quaternion::getAngle() const {
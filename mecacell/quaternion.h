@@ -11,14 +11,17 @@ struct Quaternion {
       double w;
       Quaternion(const double&, const Vector3D& );
       Quaternion(const Vector3D&, const Vector3D&);
-      Quaternion(const Quaternion& q):v(q.v),w(q.w){}
+      Quaternion(const Basis<Vector3D>&, const Basis<Vector3D>&);
+      Quaternion(const Quaternion&) = default;
+      Quaternion& operator=(const Quaternion&) = default;
       Quaternion(const double& x, const double& y, const double& z, const double& ww):v(x,y,z),w(ww){}
-      Quaternion():v(0,1,0),w(0){}
+      Quaternion():v(0,0,0),w(1){} // identity
       Quaternion operator*(const Quaternion&) const ;
       Vector3D operator*(const Vector3D&) const;
       Vector3D getAxis() const;
       double getAngle() const;
       Quaternion normalized() const;
+      Quaternion inverted() const { return Quaternion(-v.x, -v.y, -v.z, w); } // unit only
       void normalize();
       Rotation<Vector3D> toAxisAngle();
 };
@@ -0,0 +1,89 @@
+#ifndef MECACELL_SPATIALPARTITION_HPP
+#define MECACELL_SPATIALPARTITION_HPP
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "morton.hpp"
+#include "threadpool.hpp"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                     SPATIAL PARTITION
+////////////////////////////////////////////////////////////////////
+// Splits cells and connections into one block per worker of a pool. Cells are sorted
+// along a Morton curve and cut into contiguous ranges of equal size, so each block
+// covers a compact region of space; connections go through the same process using the
+// position of their first node. Each block is filled by the worker that owns it and
+// forEachBlock always runs a block on that worker, so a worker keeps processing the same
+// region of space from one step to the next (and stays on the same core with pinned
+// threads, see WorkStealingPool::pinToCores). The pointer arrays of the blocks are
+// allocated by their worker. The cells and connections stay wherever they were allocated:
+// BasicWorld::addCells builds each slice of its cells on the worker whose block will
+// hold them (it uses the same Morton cut) and creates their connections there, so that
+// on a NUMA machine most of a block's data is first touched by, and local to, its worker.
+// The blocks hold raw pointers: the partition must be rebuilt when cells or connections
+// are added or deleted. Cells that move only make the blocks less compact.
+template <typename Cell, typename Connect> class SpatialPartition {
+public:
+	struct Block {
+		std::vector<Cell *> cells;
+		std::vector<Connect *> connections;
+	};
+
+private:
+	std::vector<Block> blocks; // block b is owned by worker b
+	std::vector<std::pair<uint64_t, Cell *>> cellKeys;
+	std::vector<std::pair<uint64_t, Connect *>> connectionKeys;
+	size_t nbRebuilds = 0;
+
+	template <typename T>
+	static void sortKeys(std::vector<std::pair<uint64_t, T *>> &keys,
+	                     const std::vector<T *> &objects, const MortonEncoder &encode) {
+		keys.resize(objects.size());
+		for (size_t i = 0; i < objects.size(); ++i)
+			keys[i] = std::make_pair(encode(position(objects[i])), objects[i]);
+		std::sort(keys.begin(), keys.end());
+	}
+	static Vec position(Cell *c) { return c->getPosition(); }
+	static Vec position(Connect *c) { return c->getNode0()->getPosition(); }
+
+	template <typename T>
+	static void fill(std::vector<T *> &dest, const std::vector<std::pair<uint64_t, T *>> &keys,
+	                 size_t b, size_t nbBlocks) {
+		size_t begin = keys.size() * b / nbBlocks, end = keys.size() * (b + 1) / nbBlocks;
+		dest.clear();
+		for (size_t i = begin; i < end; ++i) dest.push_back(keys[i].second);
+	}
+
+public:
+	const std::vector<Block> &getBlocks() const { return blocks; }
+	size_t size() const { return blocks.size(); }
+	size_t getNbRebuilds() const { return nbRebuilds; }
+
+	void rebuild(const std::vector<Cell *> &cells, const std::vector<Connect *> &connections,
+	             WorkStealingPool &pool) {
+		MortonEncoder encode = MortonEncoder::fromPositions(cells.begin(), cells.end());
+		sortKeys(cellKeys, cells, encode);
+		sortKeys(connectionKeys, connections, encode);
+		blocks.resize(pool.size());
+		const size_t nbBlocks = blocks.size();
+		for (size_t b = 0; b < nbBlocks; ++b) {
+			pool.submitTo(b, [this, b, nbBlocks]() {
+				fill(blocks[b].cells, cellKeys, b, nbBlocks);
+				fill(blocks[b].connections, connectionKeys, b, nbBlocks);
+			});
+		}
+		pool.waitAll();
+		++nbRebuilds;
+	}
+
+	// runs f(block) for every block, on the block's worker
+	template <typename F> void forEachBlock(WorkStealingPool &pool, const F &f) {
+		for (size_t b = 0; b < blocks.size(); ++b)
+			pool.submitTo(b, [this, b, &f]() { f(blocks[b]); });
+		pool.waitAll();
+	}
+};
+}
+#endif
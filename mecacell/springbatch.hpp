@@ -0,0 +1,173 @@
+#ifndef MECACELL_SPRINGBATCH_HPP
+#define MECACELL_SPRINGBATCH_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "connection.h"
+
+namespace MecaCell {
+// how BasicWorld computes the cell-cell connection forces
+enum class ForceBackend {
+	PerConnection, // Connection::computeForces, one connection after the other
+	Batch          // SpringBatch
+};
+
+////////////////////////////////////////////////////////////////////
+//                     BATCH SPRING KERNEL
+////////////////////////////////////////////////////////////////////
+// Computes the spring forces of the cell-cell connections W at a time. Cell positions
+// are first copied into structure of arrays, and connections refer to their nodes by
+// index in these arrays. For each batch, the endpoint positions and spring parameters
+// are gathered into lanes, then lengths, directions and intensities are computed by
+// branch free loops over the lanes (which the compiler turns into SIMD code). The forces
+// are scatter-added into per cell accumulators, which are given to the cells at the end,
+// and the joints are computed by their connection as soon as its spring is up to date.
+// Forces are summed in a different order than with Connection::computeForces, so both
+// backends only agree up to rounding. A spring compressed under its minimum length moves
+// its nodes: its connection is skipped by the batch and computed on its own once the
+// other forces have been given to the cells.
+// The node indexes are kept between steps: invalidate() must be called when cells or
+// connections are added, deleted or reordered.
+template <typename Cell, typename Connect, size_t W = 8> class SpringBatch {
+	// topology
+	std::vector<Cell *> cells;
+	std::vector<Connect *> connections;
+	std::vector<uint32_t> node0, node1;
+	bool valid = false;
+
+	// per cell
+	std::vector<num_t> px, py, pz;     // positions
+	std::vector<num_t> fx, fy, fz, ft; // received forces (ft: signed intensities sum)
+	std::vector<char> sleeping;
+
+	// lanes
+	num_t dx[W], dy[W], dz[W]; // node1 - node0
+	num_t k[W], c[W], l[W], prevLength[W], minLength[W], on[W];
+	num_t length[W], f[W], dirx[W], diry[W], dirz[W];
+
+	std::vector<size_t> compressed; // connections left to Connection::computeForces
+	std::vector<char> skipped;      // both nodes sleeping
+
+	void rebuild(const std::vector<Cell *> &cs, const std::vector<Connect *> &cons) {
+		cells = cs;
+		connections = cons;
+		std::unordered_map<const Cell *, uint32_t> index;
+		index.reserve(cells.size());
+		for (size_t i = 0; i < cells.size(); ++i) index[cells[i]] = i;
+		node0.resize(connections.size());
+		node1.resize(connections.size());
+		for (size_t i = 0; i < connections.size(); ++i) {
+			node0[i] = index.at(connections[i]->getNode0());
+			node1[i] = index.at(connections[i]->getNode1());
+		}
+		size_t n = cells.size();
+		for (auto *v : {&px, &py, &pz, &fx, &fy, &fz, &ft}) v->resize(n);
+		sleeping.resize(n);
+		skipped.resize(connections.size());
+		valid = true;
+	}
+
+	void gather(size_t b, size_t n, bool skipSleeping) {
+		for (size_t i = 0; i < n; ++i) {
+			size_t e = b + i;
+			uint32_t a = node0[e], o = node1[e];
+			const Spring &s = connections[e]->getSc();
+			dx[i] = px[o] - px[a];
+			dy[i] = py[o] - py[a];
+			dz[i] = pz[o] - pz[a];
+			k[i] = s.k;
+			c[i] = s.c;
+			l[i] = s.l;
+			prevLength[i] = s.prevLength;
+			minLength[i] = s.minLengthRatio * s.l;
+			skipped[e] = skipSleeping && sleeping[a] && sleeping[o];
+			on[i] = connections[e]->scEnabled && !skipped[e];
+		}
+		// unused lanes hold a disabled unit spring at rest
+		for (size_t i = n; i < W; ++i) {
+			dx[i] = 1;
+			dy[i] = dz[i] = 0;
+			k[i] = c[i] = on[i] = 0;
+			l[i] = prevLength[i] = 1;
+			minLength[i] = 0;
+		}
+	}
+
+	void kernel(double dt) {
+		for (size_t i = 0; i < W; ++i)
+			length[i] = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+		// sqrt can set errno, which keeps the compiler from vectorizing its loop
+		for (size_t i = 0; i < W; ++i) length[i] = std::sqrt(length[i]);
+		for (size_t i = 0; i < W; ++i) {
+			num_t div = length[i] > 0 ? length[i] : 1;
+			dirx[i] = dx[i] / div;
+			diry[i] = dy[i] / div;
+			dirz[i] = dz[i] / div;
+			num_t x = length[i] - l[i];
+			num_t v = length[i] - prevLength[i];
+			f[i] = on[i] * (-k[i] * x - c[i] * v / dt) / 2.0;
+		}
+	}
+
+	void scatter(size_t b, size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			size_t e = b + i;
+			if (skipped[e]) continue;
+			Connect *con = connections[e];
+			Spring &s = con->getSc();
+			if (con->scEnabled && length[i] < minLength[i]) {
+				compressed.push_back(e);
+				continue;
+			}
+			s.direction = Vec(dirx[i], diry[i], dirz[i]);
+			s.length = length[i];
+			con->computeJointForces();
+			if (!con->scEnabled) continue;
+			s.prevLength = length[i];
+			uint32_t a = node0[e], o = node1[e];
+			num_t t = length[i] < l[i] ? f[i] : -f[i];
+			fx[a] -= f[i] * dirx[i];
+			fy[a] -= f[i] * diry[i];
+			fz[a] -= f[i] * dirz[i];
+			ft[a] += t;
+			fx[o] += f[i] * dirx[i];
+			fy[o] += f[i] * diry[i];
+			fz[o] += f[i] * dirz[i];
+			ft[o] += t;
+		}
+	}
+
+public:
+	void invalidate() { valid = false; }
+
+	// computes the forces of all the connections between the cells. With skipSleeping,
+	// connections between two sleeping cells are ignored
+	void computeForces(const std::vector<Cell *> &cs, const std::vector<Connect *> &cons,
+	                   double dt, bool skipSleeping) {
+		if (!valid || cs.size() != cells.size() || cons.size() != connections.size())
+			rebuild(cs, cons);
+		for (size_t i = 0; i < cells.size(); ++i) {
+			Vec p = cells[i]->getPosition();
+			px[i] = p.x;
+			py[i] = p.y;
+			pz[i] = p.z;
+			fx[i] = fy[i] = fz[i] = ft[i] = 0;
+			sleeping[i] = cells[i]->isSleeping();
+		}
+		compressed.clear();
+		for (size_t b = 0; b < connections.size(); b += W) {
+			size_t n = std::min(W, connections.size() - b);
+			gather(b, n, skipSleeping);
+			kernel(dt);
+			scatter(b, n);
+		}
+		for (size_t i = 0; i < cells.size(); ++i)
+			cells[i]->receiveForce(Vec(fx[i], fy[i], fz[i]), ft[i]);
+		for (auto e : compressed) connections[e]->computeForces(dt);
+	}
+};
+}
+#endif
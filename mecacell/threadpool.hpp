@@ -0,0 +1,166 @@
+#ifndef MECACELL_THREADPOOL_HPP
+#define MECACELL_THREADPOOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                  WORK STEALING THREAD POOL
+////////////////////////////////////////////////////////////////////
+// Each worker owns a task deque: it pops from the back of its own deque and, when it
+// runs dry, steals from the front of the others. Tasks are distributed round robin on
+// submission. waitAll() blocks until every submitted task has been executed.
+// Tasks submitted with submitTo() are pinned: they are never stolen, so that a worker
+// always processes (and first touches) the same data.
+class WorkStealingPool {
+	using Task = std::function<void()>;
+	struct Worker {
+		std::deque<Task> tasks;
+		std::deque<Task> pinned;
+		std::mutex mutex;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::condition_variable allDone;
+	std::atomic<size_t> pending{0};    // submitted but not yet finished
+	std::atomic<size_t> nextWorker{0}; // round robin submission
+	bool stopping = false;
+
+	bool tryPop(size_t id, Task &t) {
+		Worker &w = *workers[id];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.pinned.empty()) {
+			t = std::move(w.pinned.front());
+			w.pinned.pop_front();
+			return true;
+		}
+		if (w.tasks.empty()) return false;
+		t = std::move(w.tasks.back());
+		w.tasks.pop_back();
+		return true;
+	}
+
+	bool trySteal(size_t id, Task &t) {
+		for (size_t i = 1; i < workers.size(); ++i) {
+			Worker &w = *workers[(id + i) % workers.size()];
+			std::lock_guard<std::mutex> lock(w.mutex);
+			if (!w.tasks.empty()) {
+				t = std::move(w.tasks.front());
+				w.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void run(size_t id) {
+		while (true) {
+			Task t;
+			if (tryPop(id, t) || trySteal(id, t)) {
+				t();
+				if (--pending == 0) {
+					std::lock_guard<std::mutex> lock(sleepMutex);
+					allDone.notify_all();
+				}
+			} else {
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				if (stopping) return;
+				wakeUp.wait(lock, [this, id]() { return stopping || hasWork(id); });
+				if (stopping && !hasWork(id)) return;
+			}
+		}
+	}
+
+	// pinned tasks of the other workers don't count: we can't run them
+	bool hasWork(size_t id) {
+		for (size_t i = 0; i < workers.size(); ++i) {
+			std::lock_guard<std::mutex> lock(workers[i]->mutex);
+			if (!workers[i]->tasks.empty() || (i == id && !workers[i]->pinned.empty()))
+				return true;
+		}
+		return false;
+	}
+
+public:
+	WorkStealingPool(size_t nbThreads = std::thread::hardware_concurrency()) {
+		if (nbThreads == 0) nbThreads = 1;
+		for (size_t i = 0; i < nbThreads; ++i) workers.emplace_back(new Worker());
+		for (size_t i = 0; i < nbThreads; ++i) threads.emplace_back([this, i]() { run(i); });
+	}
+
+	~WorkStealingPool() {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (auto &t : threads) t.join();
+	}
+
+	WorkStealingPool(const WorkStealingPool &) = delete;
+	WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+	size_t size() const { return threads.size(); }
+
+	void submit(Task t) {
+		++pending;
+		Worker &w = *workers[nextWorker++ % workers.size()];
+		{
+			std::lock_guard<std::mutex> lock(w.mutex);
+			w.tasks.push_back(std::move(t));
+		}
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wakeUp.notify_one();
+	}
+
+	// runs t on the given worker only
+	void submitTo(size_t worker, Task t) {
+		++pending;
+		Worker &w = *workers[worker % workers.size()];
+		{
+			std::lock_guard<std::mutex> lock(w.mutex);
+			w.pinned.push_back(std::move(t));
+		}
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wakeUp.notify_all();
+	}
+
+	// binds worker i to core i (modulo the number of cores), so that the tasks always
+	// submitted to the same worker keep running on the same core. Returns false when
+	// unsupported or refused
+	bool pinToCores() {
+#ifdef __linux__
+		unsigned int nbCores = std::max(1u, std::thread::hardware_concurrency());
+		bool ok = true;
+		for (size_t i = 0; i < threads.size(); ++i) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(i % nbCores, &set);
+			ok &= pthread_setaffinity_np(threads[i].native_handle(), sizeof(set), &set) == 0;
+		}
+		return ok;
+#else
+		return false;
+#endif
+	}
+
+	void waitAll() {
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		allDone.wait(lock, [this]() { return pending == 0; });
+	}
+};
+}
+#endif
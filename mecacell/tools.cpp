@@ -144,7 +144,8 @@ Vec hsvToRgb(double h, double s, double v) {
 double dampingFromRatio(const double r, const double m, const double k) {
 	return r * 2.0 * sqrt(m * k); // for angular springs m is the moment of inertia
 }
-std::default_random_engine globalRand(std::random_device{}());
+// one engine per thread so that worlds can be updated concurrently
+thread_local std::default_random_engine globalRand(std::random_device{}());
 
 std::vector<std::string> splitStr(const std::string &s, char delim) {
 	std::vector<std::string> res;
@@ -46,7 +46,7 @@ std::pair<bool, Vec> rayInTriangle(const Vec &v0, const Vec &v1, const Vec &v2,
                                    const double tolerance = 0.0);
 
 Vec hsvToRgb(double h, double s, double v);
-extern std::default_random_engine globalRand;
+extern thread_local std::default_random_engine globalRand;
 std::vector<std::string> splitStr(const std::string &s, char delim);
 
 // return a pointer (transform reference into pointer)
@@ -0,0 +1,82 @@
+#include "transport.h"
+#ifdef MECACELL_SOCKET_TRANSPORT
+#include <cerrno>
+#include <cstdint>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace MecaCell {
+
+std::vector<SocketTransport> SocketTransport::createLocal(int nbRanks) {
+	std::vector<SocketTransport> res;
+	for (int r = 0; r < nbRanks; ++r) res.push_back(SocketTransport(r, nbRanks));
+	for (int i = 0; i < nbRanks; ++i) {
+		for (int j = i + 1; j < nbRanks; ++j) {
+			int sv[2];
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+				throw std::runtime_error("SocketTransport: socketpair failed");
+			res[i].fds[j] = sv[0];
+			res[j].fds[i] = sv[1];
+		}
+	}
+	return res;
+}
+
+SocketTransport &SocketTransport::operator=(SocketTransport &&t) {
+	for (auto &fd : fds)
+		if (fd >= 0) close(fd);
+	rank = t.rank;
+	fds = std::move(t.fds);
+	t.fds.clear();
+	return *this;
+}
+
+SocketTransport::~SocketTransport() {
+	for (auto &fd : fds)
+		if (fd >= 0) close(fd);
+}
+
+void SocketTransport::closeOthers(std::vector<SocketTransport> &all) {
+	for (auto &t : all) {
+		if (&t == this) continue;
+		for (auto &fd : t.fds)
+			if (fd >= 0) close(fd);
+		t.fds.clear();
+	}
+}
+
+void SocketTransport::writeAll(int fd, const char *buf, size_t len) {
+	while (len > 0) {
+		ssize_t n = ::write(fd, buf, len);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) throw std::runtime_error("SocketTransport: write failed");
+		buf += n;
+		len -= n;
+	}
+}
+
+void SocketTransport::readAll(int fd, char *buf, size_t len) {
+	while (len > 0) {
+		ssize_t n = ::read(fd, buf, len);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) throw std::runtime_error("SocketTransport: connection closed");
+		buf += n;
+		len -= n;
+	}
+}
+
+void SocketTransport::send(int to, const MessageBuffer &m) {
+	uint64_t len = m.data.size();
+	writeAll(fds[to], reinterpret_cast<const char *>(&len), sizeof(len));
+	if (len > 0) writeAll(fds[to], m.data.data(), len);
+}
+
+void SocketTransport::receive(int from, MessageBuffer &m) {
+	uint64_t len = 0;
+	readAll(fds[from], reinterpret_cast<char *>(&len), sizeof(len));
+	m.data.resize(len);
+	m.readPos = 0;
+	if (len > 0) readAll(fds[from], m.data.data(), len);
+}
+}
+#endif
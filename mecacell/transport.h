@@ -0,0 +1,79 @@
+#ifndef MECACELL_TRANSPORT_H
+#define MECACELL_TRANSPORT_H
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mecacell_config.h"
+
+namespace MecaCell {
+////////////////////////////////////////////////////////////////////
+//                       MESSAGE BUFFER
+////////////////////////////////////////////////////////////////////
+// flat binary buffer used to (de)serialize data exchanged between ranks
+struct MessageBuffer {
+	std::vector<char> data;
+	size_t readPos = 0;
+
+	template <typename T> void write(const T &v) {
+		static_assert(std::is_trivially_copyable<T>::value, "only raw data can be written");
+		size_t s = data.size();
+		data.resize(s + sizeof(T));
+		std::memcpy(&data[s], &v, sizeof(T));
+	}
+	template <typename T> T read() {
+		static_assert(std::is_trivially_copyable<T>::value, "only raw data can be read");
+		if (readPos + sizeof(T) > data.size())
+			throw std::runtime_error("MessageBuffer: read past the end of the message");
+		T v;
+		std::memcpy(&v, &data[readPos], sizeof(T));
+		readPos += sizeof(T);
+		return v;
+	}
+	bool atEnd() const { return readPos >= data.size(); }
+	void clear() {
+		data.clear();
+		readPos = 0;
+	}
+};
+
+#ifdef MECACELL_SOCKET_TRANSPORT
+////////////////////////////////////////////////////////////////////
+//                      SOCKET TRANSPORT
+////////////////////////////////////////////////////////////////////
+// Point to point, blocking, length prefixed messages between the ranks of a run. Each
+// pair of ranks is linked by a unix domain socket pair: createLocal(n) builds the whole
+// mesh for n ranks on the same machine. The transports can then be handed to n threads,
+// or to n processes after a fork() (each process keeps the transport of its own rank).
+// POSIX only: built when MECACELL_SOCKET_TRANSPORT is defined (cmake option of the same
+// name, on by default on unix systems, recorded in mecacell_config.h).
+class SocketTransport {
+	int rank = 0;
+	std::vector<int> fds; // socket to each other rank, -1 for ourselves
+
+	SocketTransport(int r, int size) : rank(r), fds(size, -1) {}
+	void writeAll(int fd, const char *buf, size_t len);
+	void readAll(int fd, char *buf, size_t len);
+
+public:
+	static std::vector<SocketTransport> createLocal(int nbRanks);
+
+	SocketTransport(SocketTransport &&t) : rank(t.rank), fds(std::move(t.fds)) {
+		t.fds.clear();
+	}
+	SocketTransport &operator=(SocketTransport &&t);
+	SocketTransport(const SocketTransport &) = delete;
+	SocketTransport &operator=(const SocketTransport &) = delete;
+	~SocketTransport();
+
+	int getRank() const { return rank; }
+	int getSize() const { return fds.size(); }
+	void send(int to, const MessageBuffer &m);
+	void receive(int from, MessageBuffer &m);
+	// closes the sockets that do not involve this rank (useful after a fork)
+	void closeOthers(std::vector<SocketTransport> &all);
+};
+#endif
+}
+#endif
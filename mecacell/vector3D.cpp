@@ -6,6 +6,7 @@
 #include <sstream>
 #include <random>
 #include <cstdlib>
+#include "fastmath.h"
 #include "rotation.h"
 #include "quaternion.h"
 #include "tools.h"
@@ -13,12 +14,6 @@
 using namespace std;
 namespace MecaCell {
 
-double Vector3D::dot(const Vector3D &v) const { return x * v.x + y * v.y + z * v.z; }
-
-Vector3D Vector3D::cross(const Vector3D &v) const {
-	return Vector3D((y * v.z - z * v.y), (z * v.x - x * v.z), (x * v.y - y * v.x));
-}
-
 void Vector3D::random() {
 	std::normal_distribution<double> nDist(0.0, 1.0);
 	x = nDist(globalRand);
@@ -38,55 +33,6 @@ Vector3D Vector3D::deltaDirection(double amount) {
 	return Vector3D(x + nDist(globalRand), y + nDist(globalRand), z + nDist(globalRand)).normalized();
 }
 
-Vector3D Vector3D::zero() { return Vector3D(0, 0, 0); }
-
-bool Vector3D::isZero() const { return (x == 0 && y == 0 && z == 0); }
-
-void Vector3D::operator/=(const double &d) {
-	x /= d;
-	y /= d;
-	z /= d;
-}
-
-void Vector3D::operator*=(const double &d) {
-	x *= d;
-	y *= d;
-	z *= d;
-}
-
-void Vector3D::operator+=(const Vector3D &v) {
-	x += v.x;
-	y += v.y;
-	z += v.z;
-}
-
-Vector3D Vector3D::operator+(const Vector3D &v) const { return Vector3D(x + v.x, y + v.y, z + v.z); }
-Vector3D Vector3D::operator-(const Vector3D &v) const { return Vector3D(x - v.x, y - v.y, z - v.z); }
-Vector3D Vector3D::operator-(const double &v) const { return Vector3D(x - v, y - v, z - v); }
-Vector3D Vector3D::operator+(const double &v) const { return Vector3D(x + v, y + v, z + v); }
-Vector3D Vector3D::operator/(const double &s) const { return Vector3D(x / s, y / s, z / s); }
-Vector3D Vector3D::operator/(const Vector3D &v) const { return Vector3D(x / v.x, y / v.y, z / v.z); }
-Vector3D Vector3D::operator-() const { return Vector3D(-x, -y, -z); }
-
-bool Vector3D::operator>=(const double &v) const { return (x >= v && y >= v && z >= v); }
-bool Vector3D::operator<=(const double &v) const { return (x <= v && y <= v && z <= v); }
-bool Vector3D::operator>(const double &v) const { return (x > v && y > v && z > v); }
-bool Vector3D::operator<(const double &v) const { return (x < v && y < v && z < v); }
-
-double Vector3D::length() const { return sqrt(x * x + y * y + z * z); }
-double Vector3D::sqlength() const { return (x * x + y * y + z * z); }
-
-double Vector3D::getX() const { return x; }
-double Vector3D::getY() const { return y; }
-double Vector3D::getZ() const { return z; }
-
-void Vector3D::normalize() { *this = *this / length(); }
-
-Vector3D Vector3D::normalized() const {
-	double l = length();
-	return Vector3D(x / l, y / l, z / l);
-}
-
 std::string Vector3D::toString() {
 	std::stringstream s;
 	s.precision(500);
@@ -135,12 +81,6 @@ void Vector3D::iterateTo(Vector3D const &v, const std::function<void(const Vecto
 	}
 }
 
-Vector3D Vector3D::ortho() const {
-	if (y == 0 && x == 0) {
-		return Vector3D(0, 1, 0);
-	}
-	return Vector3D(-y, x, 0);
-}
 Vector3D Vector3D::ortho(Vector3D v) const {
 	if ((v - *this).sqlength() > 0.000000001) {
 		Vector3D res = cross(v);
@@ -150,17 +90,15 @@ Vector3D Vector3D::ortho(Vector3D v) const {
 }
 
 Vector3D Vector3D::rotated(const double &angle, const Vector3D &vec) const {
-	double halfangle = angle * 0.5;
-	Vector3D v = vec * sin(halfangle);
+	double s, c;
+	halfAngleSinCos(angle, s, c);
+	Vector3D v = vec * s;
 	Vector3D vcV = 2.0 * v.cross(*this);
-	return *this + cos(halfangle) * vcV + v.cross(vcV);
+	return *this + c * vcV + v.cross(vcV);
 }
 
 Vector3D Vector3D::rotated(const Rotation<Vector3D> &r) const {
-	double halfangle = r.teta * 0.5;
-	Vector3D v = r.n * sin(halfangle);
-	Vector3D vcV = 2.0 * v.cross(*this);
-	return *this + cos(halfangle) * vcV + v.cross(vcV);
+	return rotated(r.teta, r.n);
 }
 // return Quaternion(r.teta, r.n) * *this; }
 
@@ -185,11 +123,11 @@ void Vector3D::addAsAngularVelocity(const Vector3D &v, Rotation<Vector3D> &r) {
 }
 
 
-double Vector3D::rayCast(const Vector3D &o, const Vector3D &n, const Vector3D &p, const Vector3D &r) {
+num_t Vector3D::rayCast(const Vector3D &o, const Vector3D &n, const Vector3D &p, const Vector3D &r) {
 	// returns l such that p + l.r lies on the plane defined by its normal n and an offset o
 	// l > 0 means that the ray hits the plane, l < 0 means that the ray dos not face the plane
 	// l = 0 means that the ray is parallel to the plane or that p is on the plane
-	double nr = n.dot(r);
+	num_t nr = n.dot(r);
 	return (nr == 0) ? 0 : n.dot(o - p) / nr;
 }
 
@@ -205,8 +143,14 @@ Vector3D Vector3D::getProjection(const Vector3D &origin, const Vector3D &B, cons
 }
 
 Rotation<Vector3D> Vector3D::getRotation(const Vector3D &v0, const Vector3D &v1) {
+	// v0 and v1 are unit vectors: |v1 - v0| = 2.sin(teta / 2), which avoids acos for
+	// small angles (and is more accurate than acos(v0.v1) near 0)
 	Rotation<Vector3D> res;
-	res.teta = acos(min(1.0, max(-1.0, v0.dot(v1))));
+	double sqHalfChord = (v1 - v0).sqlength() * 0.25;
+	if (sqHalfChord <= 0.0625)
+		res.teta = 2.0 * smallAsin(sqrt(sqHalfChord));
+	else
+		res.teta = acos(min<double>(1.0, max<double>(-1.0, v0.dot(v1))));
 	Vector3D cross = v0.cross(v1);
 	if (cross.sqlength() == 0) {
 		cross = Vector3D(0, 1, 0);
@@ -221,20 +165,9 @@ Rotation<Vector3D> Vector3D::getRotation(const Basis<Vector3D> &b0, const Basis<
 
 Rotation<Vector3D> Vector3D::getRotation(const Vector3D &X0, const Vector3D &Y0, const Vector3D &X1,
                                          const Vector3D &Y1) {
-	Quaternion q0(X0.normalized(), X1.normalized());
-	Vector3D Ytmp = q0 * Y0;
-	Ytmp.normalize();
-	Quaternion qres = Quaternion(Ytmp, Y1.normalized()) * q0;
-	qres.normalize();
-	return qres.toAxisAngle();
+	return Quaternion(Basis<Vector3D>(X0, Y0), Basis<Vector3D>(X1, Y1)).toAxisAngle();
 }
 
-Vector3D operator*(const Vector3D &v, const double &s) { return Vector3D(v.x * s, v.y * s, v.z * s); }
-Vector3D operator*(const double &s, const Vector3D &v) { return Vector3D(v.x * s, v.y * s, v.z * s); }
-
-bool operator==(const Vector3D &a, const Vector3D &b) { return (a.x == b.x && a.y == b.y && a.z == b.z); }
-bool operator!=(const Vector3D &a, const Vector3D &b) { return !operator==(a, b); }
-
 ostream &operator<<(ostream &out, const Vector3D &v) {
 	out << "(" << v.x << ", " << v.y << ", " << v.z << ")";
 	return out;
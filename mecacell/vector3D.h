@@ -1,48 +1,105 @@
 #ifndef VECTOR3D_H
 #define VECTOR3D_H
 #include <cmath>
+#include <cstddef>
 #include <functional>
 #include <iostream>
+#include "mecacell_config.h"
 #include "rotation.h"
 #include "basis.h"
 
 namespace MecaCell {
-class Vector3D {
+// scalar type used by vectors and by the mechanics (springs, joints, grids).
+// MECACELL_SINGLE_PRECISION (cmake option of the same name, recorded in
+// mecacell_config.h) switches it to float, which halves the memory traffic of the force
+// loops at the cost of accuracy. Angles, time steps and user-facing parameters stay
+// double
+#ifdef MECACELL_SINGLE_PRECISION
+using num_t = float;
+#else
+using num_t = double;
+#endif
+
+// MECACELL_VEC_PADDED adds a 4th (unused) component so that vectors fill a 4 wide SIMD
+// register and arrays of vectors can be loaded without shuffles. The alignment is capped
+// to what operator new guarantees in c++11. Like MECACELL_SINGLE_PRECISION, it is a cmake
+// option recorded in mecacell_config.h, since it changes the layout of exported types
+#ifdef MECACELL_VEC_PADDED
+#define MECACELL_VEC_ALIGN                                                               \
+	alignas(4 * sizeof(num_t) < alignof(std::max_align_t) ? 4 * sizeof(num_t)           \
+	                                                       : alignof(std::max_align_t))
+#else
+#define MECACELL_VEC_ALIGN
+#endif
+
+// arithmetic is defined inline (and constexpr when c++11 allows it) so that it can be
+// inlined and vectorized in user translation units
+class MECACELL_VEC_ALIGN Vector3D {
 public:
-	double x, y, z;
+	num_t x, y, z;
+#ifdef MECACELL_VEC_PADDED
+	num_t w = 0;
+#endif
 	static const int dimension = 3;
-	Vector3D(double a, double b, double c) : x(a), y(b), z(c) {}
-	Vector3D() : x(0), y(0), z(0) {}
-	explicit Vector3D(double a) : x(a), y(a), z(a) {}
-	Vector3D(const Vector3D &v) : x(v.x), y(v.y), z(v.z) {}
+	constexpr Vector3D(num_t a, num_t b, num_t c) : x(a), y(b), z(c) {}
+	constexpr Vector3D() : x(0), y(0), z(0) {}
+	explicit constexpr Vector3D(num_t a) : x(a), y(a), z(a) {}
+	Vector3D(const Vector3D &) = default;
+	Vector3D &operator=(const Vector3D &) = default;
 
-	double dot(const Vector3D &v) const;
-	Vector3D cross(const Vector3D &v) const;
+	constexpr num_t dot(const Vector3D &v) const { return x * v.x + y * v.y + z * v.z; }
+	constexpr Vector3D cross(const Vector3D &v) const {
+		return Vector3D((y * v.z - z * v.y), (z * v.x - x * v.z), (x * v.y - y * v.x));
+	}
 
 	void random();
 	Vector3D deltaDirection(double amount);
 	static Vector3D randomUnit();
-	static Vector3D zero();
-	bool isZero() const;
+	static constexpr Vector3D zero() { return Vector3D(0, 0, 0); }
+	constexpr bool isZero() const { return (x == 0 && y == 0 && z == 0); }
 
-	void operator*=(const double &d);
-	void operator/=(const double &d);
-	void operator+=(const Vector3D &v);
-	Vector3D operator+(const Vector3D &v) const;
-	Vector3D operator-(const Vector3D &v) const;
-	Vector3D operator-(const double &v) const;
-	Vector3D operator+(const double &v) const;
-	Vector3D operator/(const double &s) const;
-	Vector3D operator/(const Vector3D &v) const;
-	Vector3D operator-() const;
+	void operator*=(const num_t &d) {
+		x *= d;
+		y *= d;
+		z *= d;
+	}
+	void operator/=(const num_t &d) {
+		x /= d;
+		y /= d;
+		z /= d;
+	}
+	void operator+=(const Vector3D &v) {
+		x += v.x;
+		y += v.y;
+		z += v.z;
+	}
+	constexpr Vector3D operator+(const Vector3D &v) const {
+		return Vector3D(x + v.x, y + v.y, z + v.z);
+	}
+	constexpr Vector3D operator-(const Vector3D &v) const {
+		return Vector3D(x - v.x, y - v.y, z - v.z);
+	}
+	constexpr Vector3D operator-(const num_t &v) const {
+		return Vector3D(x - v, y - v, z - v);
+	}
+	constexpr Vector3D operator+(const num_t &v) const {
+		return Vector3D(x + v, y + v, z + v);
+	}
+	constexpr Vector3D operator/(const num_t &s) const {
+		return Vector3D(x / s, y / s, z / s);
+	}
+	constexpr Vector3D operator/(const Vector3D &v) const {
+		return Vector3D(x / v.x, y / v.y, z / v.z);
+	}
+	constexpr Vector3D operator-() const { return Vector3D(-x, -y, -z); }
 
-	bool operator>=(const double &v) const;
-	bool operator<=(const double &v) const;
-	bool operator>(const double &v) const;
-	bool operator<(const double &v) const;
+	constexpr bool operator>=(const num_t &v) const { return (x >= v && y >= v && z >= v); }
+	constexpr bool operator<=(const num_t &v) const { return (x <= v && y <= v && z <= v); }
+	constexpr bool operator>(const num_t &v) const { return (x > v && y > v && z > v); }
+	constexpr bool operator<(const num_t &v) const { return (x < v && y < v && z < v); }
 
-	double length() const;
-	double sqlength() const;
+	num_t length() const { return sqrt(x * x + y * y + z * z); }
+	constexpr num_t sqlength() const { return (x * x + y * y + z * z); }
 
 	Vector3D rotated(const double &, const Vector3D &) const;
 	Vector3D rotated(const Rotation<Vector3D> &) const;
@@ -55,14 +112,17 @@ public:
 	static Rotation<Vector3D> getRotation(const Basis<Vector3D> &, const Basis<Vector3D> &);
 	static Vector3D getProjection(const Vector3D &origin, const Vector3D &A, const Vector3D &B);
 	static Vector3D getProjectionOnPlane(const Vector3D &o, const Vector3D &n, const Vector3D &p);
-	static double rayCast(const Vector3D &o, const Vector3D &n, const Vector3D &p, const Vector3D &r);
+	static num_t rayCast(const Vector3D &o, const Vector3D &n, const Vector3D &p, const Vector3D &r);
 
-	double getX() const;
-	double getY() const;
-	double getZ() const;
+	constexpr num_t getX() const { return x; }
+	constexpr num_t getY() const { return y; }
+	constexpr num_t getZ() const { return z; }
 
-	void normalize();
-	Vector3D normalized() const;
+	void normalize() { *this = *this / length(); }
+	Vector3D normalized() const {
+		num_t l = length();
+		return Vector3D(x / l, y / l, z / l);
+	}
 
 	std::string toString();
 	static int getHash(int a, int b);
@@ -70,14 +130,24 @@ public:
 
 	void iterateTo(Vector3D const &v, const std::function<void(const Vector3D &)> &fun, int inc = 1);
 
-	Vector3D ortho() const;
+	constexpr Vector3D ortho() const {
+		return (y == 0 && x == 0) ? Vector3D(0, 1, 0) : Vector3D(-y, x, 0);
+	}
 	Vector3D ortho(Vector3D v) const;
 	friend ostream &operator<<(ostream &out, const Vector3D &v);
 };
-Vector3D operator*(const Vector3D &v, const double &s);
-Vector3D operator*(const double &s, const Vector3D &v);
-bool operator==(const Vector3D &a, const Vector3D &b);
-bool operator!=(const Vector3D &a, const Vector3D &b);
+inline constexpr Vector3D operator*(const Vector3D &v, const num_t &s) {
+	return Vector3D(v.x * s, v.y * s, v.z * s);
+}
+inline constexpr Vector3D operator*(const num_t &s, const Vector3D &v) {
+	return Vector3D(v.x * s, v.y * s, v.z * s);
+}
+inline constexpr bool operator==(const Vector3D &a, const Vector3D &b) {
+	return (a.x == b.x && a.y == b.y && a.z == b.z);
+}
+inline constexpr bool operator!=(const Vector3D &a, const Vector3D &b) {
+	return !(a == b);
+}
 }
 namespace std {
 template <> struct hash<MecaCell::Vector3D> {
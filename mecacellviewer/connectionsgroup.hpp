@@ -36,8 +36,8 @@ public:
 		lines.vertices = std::vector<float>();
 		for (auto &c : cells) {
 			for (auto &conne : c->getRWModelConnections()) {
-				QVector3D center0 = toQV3D(conne->bounce.getNode0().getPosition());
-				QVector3D center1 = toQV3D(conne->bounce.getNode1()->getPosition());
+				QVector3D center0 = toQV3D(conne->bouncePoint.getPosition());
+				QVector3D center1 = toQV3D(conne->cell->getPosition());
 				lines.vertices.push_back(center0.x());
 				lines.vertices.push_back(center0.y());
 				lines.vertices.push_back(center0.z());
@@ -53,8 +53,8 @@ public:
 		lines.vertices = std::vector<float>();
 		for (auto &c : cells) {
 			for (auto &conne : c->getRWModelConnections()) {
-				QVector3D center0 = toQV3D(conne->anchor.getNode0().getPosition());
-				QVector3D center1 = toQV3D(conne->anchor.getNode1()->getPosition());
+				QVector3D center0 = toQV3D(conne->anchorPoint.getPosition());
+				QVector3D center1 = toQV3D(conne->cell->getPosition());
 				lines.vertices.push_back(center0.x());
 				lines.vertices.push_back(center0.y());
 				lines.vertices.push_back(center0.z());
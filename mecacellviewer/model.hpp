@@ -23,17 +23,16 @@ template <typename Model> struct ModelViewer {
 			vertices.push_back(v.z);
 		}
 		normals.resize(vertices.size());
-		for (auto &f : m.obj.faces) {
-
-			assert(f.count("v") && f.count("n"));
-			for (auto &vid : f.at("v").indices) {
-				assert(vid < m.obj.vertices.size());
+		const auto &obj = m.data->obj;
+		for (size_t f = 0; f < obj.faces.size(); ++f) {
+			for (auto &vid : obj.faces[f].indices) {
+				assert(vid < obj.vertices.size());
 				indices.push_back(vid);
 			}
-
+			if (m.normals.empty()) continue;
 			for (int id = 0; id < 3; ++id) {
-				size_t vid = f.at("v").indices[id];
-				size_t nid = f.at("n").indices[id];
+				size_t vid = obj.faces[f].indices[id];
+				size_t nid = obj.normalFaces[f].indices[id];
 				normals[vid * 3 + 0] = m.normals[nid].x;
 				normals[vid * 3 + 1] = m.normals[nid].y;
 				normals[vid * 3 + 2] = m.normals[nid].z;
@@ -154,8 +154,10 @@ private:
 			           camera.getPosition(), cMode, selectedCell);
 		}
 		if (gc.contains("cellGrid")) {
-			gridViewer.draw(scenario.getWorld().getCellGrid(), view, projection,
-			                QVector4D(0.99, 0.9, 0.4, 1.0));
+			const auto &cellGrid = scenario.getWorld().getCellGrid();
+			for (size_t l = 0; l < cellGrid.getNbLevels(); ++l)
+				gridViewer.draw(cellGrid.getLevel(l), view, projection,
+				                QVector4D(0.99, 0.9, 0.4, 1.0));
 		}
 		if (gc.contains("modelGrid")) {
 			gridViewer.draw(scenario.getWorld().getModelGrid(), view, projection,
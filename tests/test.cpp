@@ -4,7 +4,30 @@
 
 using namespace MecaCell;
 
-bool doubleEq(double a, double b) { return abs(a - b) < 0.00000000001; }
+// tolerances depend on the precision mecacell was compiled with
+#ifdef MECACELL_SINGLE_PRECISION
+const double EPSILON = 1e-4;
+const double ROT_EPSILON = 1e-5;
+#else
+const double EPSILON = 0.00000000001;
+const double ROT_EPSILON = 1e-9;
+#endif
+
+bool doubleEq(double a, double b) { return abs(a - b) < EPSILON; }
+
+class TestCell : public ConnectableCell<TestCell> {
+public:
+	TestCell(const Vec &v) : ConnectableCell<TestCell>(v) {}
+	TestCell(const TestCell &c, const Vec &translation)
+	    : ConnectableCell<TestCell>(c, translation) {}
+	double lastBehaviorDt = 0;
+	double getAdhesionWith(const TestCell *) { return 0.5; }
+	TestCell *updateBehavior(double dt) {
+		lastBehaviorDt = dt;
+		return nullptr;
+	}
+};
+using TestWorld = BasicWorld<TestCell, Euler>;
 
 TEST_CASE("Trigo, vectors & rotations") {
 	Vec a(-10, -5, 2);
@@ -21,3 +44,782 @@ TEST_CASE("Trigo, vectors & rotations") {
 	REQUIRE(doubleEq(closestDistToTriangleEdge(a, b, c, Vec(-7, -6.3, 2)), 1.3));
 	REQUIRE(doubleEq(closestDistToTriangleEdge(a, b, c, Vec(-7, -6.3, 3)), sqrt(1.0 + 1.3 * 1.3)));
 }
+
+// compile time checks: a failure breaks the build, the test case only groups them
+TEST_CASE("Vector layout & constant expressions") {
+	// vector arithmetic is usable in constant expressions
+	constexpr Vec u(1, 2, 3);
+	static_assert((u + u * 2.0).dot(Vec(1, 0, 0)) == 3.0, "constexpr vector arithmetic");
+	static_assert(u.cross(u).isZero(), "constexpr cross product");
+#ifdef MECACELL_VEC_PADDED
+	static_assert(sizeof(Vec) == 4 * sizeof(num_t), "padded vectors fill 4 lanes");
+#else
+	static_assert(sizeof(Vec) == 3 * sizeof(num_t), "vectors are 3 packed components");
+#endif
+	SUCCEED();
+}
+
+TEST_CASE("Ensemble runs") {
+	Ensemble<TestWorld> ensemble(4);
+	auto summaries = ensemble.run(16, 20, [](TestWorld &w, size_t run) {
+		for (size_t i = 0; i <= run; ++i)
+			w.addCell(new TestCell(Vec(static_cast<double>(i) * DEFAULT_CELL_RADIUS, 0, 0)));
+	});
+	REQUIRE(summaries.size() == 16);
+	for (size_t r = 0; r < summaries.size(); ++r) {
+		REQUIRE(summaries[r].run == r);
+		REQUIRE(summaries[r].nbCells == r + 1);
+		REQUIRE(summaries[r].nbUpdates == 20);
+		REQUIRE(summaries[r].nbConnections == r);
+	}
+	REQUIRE(ensemble.getDurations().size() == 16);
+	// runs draw the same random numbers whatever the number of workers
+	struct RandomSummary {
+		Vec position;
+	};
+	auto randomRuns = [](size_t nbThreads) {
+		Ensemble<TestWorld, RandomSummary> e(nbThreads);
+		e.setSeed(7);
+		return e.run(
+		    8, 5, [](TestWorld &w, size_t) { w.addCell(new TestCell(Vec::randomUnit())); },
+		    [](TestWorld &w, size_t) { return RandomSummary{w.cells[0]->getPosition()}; });
+	};
+	auto serial = randomRuns(1), parallel = randomRuns(3);
+	for (size_t r = 0; r < serial.size(); ++r) {
+		REQUIRE(serial[r].position == parallel[r].position);
+		if (r > 0) REQUIRE(serial[r].position != serial[r - 1].position);
+	}
+}
+
+TEST_CASE("Obj parsing") {
+	std::stringstream obj;
+	obj << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+	    << "vt 0 0\nvt 1 1\nvn 0 0 1\n"
+	    << "f 1/1/1 2/2/1 3/1/1\n"
+	    << "f 2//1 4//1 3//1\n"
+	    << "f 1 2 4\n";
+	ModelData d(obj);
+	REQUIRE(d.obj.vertices.size() == 4);
+	REQUIRE(d.obj.uv.size() == 2);
+	REQUIRE(d.obj.normals.size() == 1);
+	REQUIRE(d.obj.faces.size() == 3);
+	REQUIRE(d.obj.uvFaces.size() == 3);
+	REQUIRE(d.obj.normalFaces.size() == 3);
+	REQUIRE(d.obj.faces[1].indices[1] == 3);
+	REQUIRE(d.obj.uvFaces[0].indices[1] == 1);
+	REQUIRE(d.obj.uvFaces[1].indices[1] == 0);
+	REQUIRE(d.obj.normalFaces[1].indices[2] == 0);
+	REQUIRE(d.obj.faces[2].indices[2] == 3);
+}
+
+TEST_CASE("Model adjacency") {
+	std::stringstream obj;
+	obj << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nv 2 0 0\nv 5 5 5\nv 6 5 5\nv 5 6 5\n"
+	    << "f 1 2 3\nf 2 4 3\nf 2 5 4\nf 6 7 8\n";
+	ModelData d(obj);
+	REQUIRE(d.adjacencyOffsets.size() == 5);
+	REQUIRE(d.getNbAdjacentFaces(0) == 2);
+	REQUIRE(d.getNbAdjacentFaces(1) == 2);
+	REQUIRE(d.getNbAdjacentFaces(2) == 2);
+	REQUIRE(d.getNbAdjacentFaces(3) == 0);
+	REQUIRE(d.getAdjacentFace(0, 0) == 1);
+	REQUIRE(d.getAdjacentFace(0, 1) == 2);
+	REQUIRE(d.getAdjacentFace(1, 0) == 0);
+	REQUIRE(d.getAdjacentFace(2, 1) == 1);
+}
+
+TEST_CASE("Quaternion orientation") {
+	Orientable o;
+	Rotation<Vec> r;
+	Basis<Vec> b;
+	Vec displacements[] = {Vec(0.1, 0, 0), Vec(0, 0.3, -0.2), Vec(0.01, 0.02, 0.5),
+	                       Vec(-1.0, 0.4, 0.2), Vec(0, 0, 0)};
+	for (const auto &d : displacements) {
+		o.addAngularDisplacement(d);
+		r = r + d;
+	}
+	o.updateCurrentOrientation();
+	b.updateWithRotation(r);
+	REQUIRE((o.getOrientation().X - b.X).length() < ROT_EPSILON);
+	REQUIRE((o.getOrientation().Y - b.Y).length() < ROT_EPSILON);
+	Basis<Vec> b2;
+	b2.updateWithRotation(o.getOrientationRotation());
+	REQUIRE((b2.X - b.X).length() < ROT_EPSILON);
+	REQUIRE((b2.Y - b.Y).length() < ROT_EPSILON);
+}
+
+TEST_CASE("Cached orientation matrix") {
+	TestWorld w;
+	for (int i = 0; i < 3; ++i)
+		w.addCell(new TestCell(1.6 * DEFAULT_CELL_RADIUS * Vec(i, 0.1 * i * i, 0)));
+	w.update();
+	REQUIRE(w.connections.size() == 2);
+	// rotates v with the basis of the cell's orientation, as axis-angle
+	auto basisRotate = [](const TestCell *c, const Vec &v) {
+		Basis<Vec> b;
+		b.updateWithRotation(c->getOrientationRotation());
+		return b.X * v.x + b.Y * v.y + b.X.cross(b.Y) * v.z;
+	};
+	auto checkJoint = [&](const Joint &jt, const TestCell *c) {
+		Joint j = jt;
+		j.updateDirection(c->getOrientationMatrix());
+		REQUIRE((j.direction - c->getOrientationQuaternion() * j.localDirection).length() <
+		        ROT_EPSILON);
+		REQUIRE((j.direction - basisRotate(c, j.localDirection)).length() < ROT_EPSILON);
+	};
+	const Vec probes[] = {Vec(1, 0, 0), Vec(0, 1, 0), Vec(0, 0, 1), Vec(0.3, -0.5, 0.8)};
+	for (int step = 0; step < 50; ++step) {
+		// keeps the cells spinning against the joints and the damping
+		for (size_t i = 0; i < w.cells.size(); ++i)
+			w.cells[i]->setAngularVelocity(Vec(1.0, -0.5 * i, 0.5 + i));
+		w.update();
+		for (auto &c : w.cells) {
+			const Matrix3x3 &m = c->getOrientationMatrix();
+			for (const auto &v : probes) {
+				REQUIRE((m * v - c->getOrientationQuaternion() * v).length() < ROT_EPSILON);
+				REQUIRE((m * v - basisRotate(c, v)).length() < ROT_EPSILON);
+				REQUIRE((m.transposedProduct(m * v) - v).length() < ROT_EPSILON);
+			}
+			REQUIRE((m.column(0) - c->getOrientation().X).length() < ROT_EPSILON);
+			REQUIRE((m.column(1) - c->getOrientation().Y).length() < ROT_EPSILON);
+		}
+		for (auto &con : w.connections) {
+			checkJoint(con->getFlex().first, con->getNode0());
+			checkJoint(con->getFlex().second, con->getNode1());
+			checkJoint(con->getTorsion().first, con->getNode0());
+			checkJoint(con->getTorsion().second, con->getNode1());
+		}
+	}
+	for (auto &c : w.cells) REQUIRE(c->getOrientation().X.dot(Vec(1, 0, 0)) < 0.9);
+}
+
+TEST_CASE("Fast rotation primitives") {
+	std::default_random_engine rng(3);
+	std::normal_distribution<double> normal;
+	for (int i = 0; i < 2000; ++i) {
+		Vec v0 = Vec(normal(rng), normal(rng), normal(rng)).normalized();
+		// from tiny to half turn angles, both sides of the polynomial range
+		double angle = M_PI * pow(10.0, -6.0 * (i % 100) / 100.0) * (i % 2 ? 1.0 : 0.3);
+		Vec axis = v0.cross(Vec(normal(rng), normal(rng), normal(rng))).normalized();
+		// reference rotation (Rodrigues)
+		Vec v1 = v0 * cos(angle) + axis.cross(v0) * sin(angle) +
+		         axis * axis.dot(v0) * (1.0 - cos(angle));
+		REQUIRE((v0.rotated(angle, axis) - v1).length() < ROT_EPSILON);
+		REQUIRE((v0.rotated(Rotation<Vec>(axis, angle)) - v1).length() < ROT_EPSILON);
+		Rotation<Vec> r = Vec::getRotation(v0, v1);
+		REQUIRE(fabs(r.teta - angle) < 10 * ROT_EPSILON);
+		REQUIRE((r.n.normalized() - axis).length() < 10 * ROT_EPSILON / angle);
+		Rotation<Vec> q = Quaternion(angle, axis).toAxisAngle();
+		REQUIRE(fabs(q.teta - angle) < 10 * ROT_EPSILON);
+	}
+}
+
+// 3 very stiff cells in a row, with a time step far too large for explicit schemes
+template <typename W> void addStiffRow(W &w) {
+	w.setDt(0.5);
+	for (int i = 0; i < 3; ++i) {
+		TestCell *c = new TestCell(Vec(i * 1.2 * DEFAULT_CELL_RADIUS, 0, 0));
+		c->setStiffness(DEFAULT_CELL_STIFFNESS * 50.0);
+		w.addCell(c);
+	}
+}
+// are the connections and velocities of the row within the bounds of a stable solution
+template <typename W> bool stiffRowIsStable(W &w) {
+	if (w.connections.size() != 2) return false;
+	for (auto &c : w.connections)
+		if (!(c->getLength() > 0.5 * c->getSc().l && c->getLength() < 1.5 * c->getSc().l))
+			return false;
+	for (auto &c : w.cells)
+		if (!(c->getVelocity().length() < 1.0)) return false;
+	return true;
+}
+
+TEST_CASE("Implicit integration of stiff cells") {
+	BasicWorld<TestCell, ImplicitEuler> w;
+	addStiffRow(w);
+	for (int i = 0; i < 500; ++i) w.update();
+	REQUIRE(w.connections.size() == 2);
+	for (auto &c : w.connections) {
+		REQUIRE(c->getLength() > 0.5 * c->getSc().l);
+		REQUIRE(c->getLength() < 1.5 * c->getSc().l);
+	}
+	for (auto &c : w.cells) REQUIRE(c->getVelocity().length() < 1.0);
+	// the same scene leaves these bounds with Euler (stops at the first unstable step)
+	TestWorld explicitW;
+	addStiffRow(explicitW);
+	bool stable = true;
+	for (int i = 0; i < 500 && stable; ++i) {
+		explicitW.update();
+		stable = stiffRowIsStable(explicitW);
+	}
+	REQUIRE(!stable);
+}
+
+TEST_CASE("Adaptive time step") {
+	TestWorld w;
+	w.setDt(0.01);
+	w.enableAdaptiveDt(0.0001, 0.1, 0.02);
+	w.addCell(new TestCell(Vec(0, 0, 0)));
+	for (int i = 0; i < 50; ++i) w.update();
+	// nothing moves: dt grows up to its upper bound
+	REQUIRE(w.getDtHistory().size() == 50);
+	REQUIRE(doubleEq(w.getDtHistory().back(), 0.1));
+	// violent overlap: steps get rejected and dt shrinks
+	w.addCell(new TestCell(Vec(0.3 * DEFAULT_CELL_RADIUS, 0, 0)));
+	for (int i = 0; i < 3; ++i) w.update();
+	REQUIRE(w.getNbRejectedSteps() > 0);
+	REQUIRE(w.getDtHistory().back() < 0.1);
+	for (int i = 0; i < 200; ++i) w.update();
+	for (auto &d : w.getDtHistory()) {
+		REQUIRE(d >= 0.0001);
+		REQUIRE(d <= 0.1);
+	}
+}
+
+TEST_CASE("Mechanical substeps") {
+	TestWorld w;
+	w.setDt(0.01);
+	w.setNbMechanicalSubsteps(10);
+	w.setGridUpdatePeriod(4);
+	w.addCell(new TestCell(Vec(0, 0, 0)));
+	w.addCell(new TestCell(Vec(1.5 * DEFAULT_CELL_RADIUS, 0, 0)));
+	for (int i = 0; i < 3; ++i) w.update();
+	REQUIRE(w.getNbUpdates() == 3);
+	REQUIRE(w.getNbMechanicalSteps() == 30);
+	REQUIRE(w.connections.size() == 1);
+	for (auto &c : w.cells) REQUIRE(doubleEq(c->lastBehaviorDt, 0.1));
+}
+
+class DividingCell : public ConnectableCell<DividingCell> {
+public:
+	int age = 0;
+	DividingCell(const Vec &v) : ConnectableCell<DividingCell>(v) {}
+	DividingCell(const DividingCell &c, const Vec &translation)
+	    : ConnectableCell<DividingCell>(c, translation) {}
+	double getAdhesionWith(const DividingCell *) { return 0.5; }
+	DividingCell *updateBehavior(double) {
+		if (++age % 10 == 0) return divide();
+		grow(0.01);
+		return nullptr;
+	}
+};
+
+TEST_CASE("Parallel behavior is deterministic") {
+	vector<vector<Vec>> results;
+	for (size_t nbThreads : {2, 4}) {
+		BasicWorld<DividingCell, Euler> w;
+		w.setNbBehaviorThreads(nbThreads);
+		w.setBehaviorChunkSize(3);
+		w.addCell(new DividingCell(Vec::zero()));
+		for (int i = 0; i < 45; ++i) w.update();
+		REQUIRE(w.cells.size() == 16);
+		results.push_back(vector<Vec>());
+		for (auto &c : w.cells) {
+			REQUIRE(!c->hasPendingConnectionUpdate());
+			results.back().push_back(c->getPosition());
+		}
+	}
+	for (size_t i = 0; i < results[0].size(); ++i) REQUIRE(results[0][i] == results[1][i]);
+}
+
+TEST_CASE("Sleeping cells") {
+	TestWorld w;
+	w.enableSleeping(1e-3, 1e-2, 20);
+	for (int i = 0; i < 4; ++i)
+		w.addCell(new TestCell(Vec(i * 1.5 * DEFAULT_CELL_RADIUS, 0, 0)));
+	for (int i = 0; i < 3000; ++i) w.update();
+	REQUIRE(w.getNbSleepingCells() == 4);
+	vector<Vec> positions;
+	for (auto &c : w.cells) positions.push_back(c->getPosition());
+	for (int i = 0; i < 10; ++i) w.update();
+	for (size_t i = 0; i < w.cells.size(); ++i)
+		REQUIRE(w.cells[i]->getPosition() == positions[i]);
+	// an external force wakes a cell up
+	w.cells[3]->receiveForce(Vec(0, 2e-2, 0));
+	w.update();
+	REQUIRE(!w.cells[3]->isSleeping());
+	REQUIRE(w.cells[3]->getPosition().y > positions[3].y);
+	for (int i = 0; i < 3000 && w.getNbSleepingCells() < 4; ++i) w.update();
+	REQUIRE(w.getNbSleepingCells() == 4);
+	// a new contact wakes the cluster up
+	w.addCell(new TestCell(Vec(-0.5 * DEFAULT_CELL_RADIUS, 0, 0)));
+	for (int i = 0; i < 5; ++i) w.update();
+	REQUIRE(w.getNbSleepingCells() < 4);
+	REQUIRE(!w.cells[0]->isSleeping());
+}
+
+TEST_CASE("Partitioned parallel mechanics") {
+	REQUIRE(mortonCode(1, 0, 0) == 1);
+	REQUIRE(mortonCode(0, 1, 0) == 2);
+	REQUIRE(mortonCode(0, 0, 1) == 4);
+	REQUIRE(mortonCode(3, 3, 3) == 63);
+	vector<vector<Vec>> results;
+	for (size_t nbThreads : {1, 3}) {
+		TestWorld w;
+		w.setNbMechanicsThreads(nbThreads);
+		w.setG(Vec(0, -20, 0));
+		for (int i = 0; i < 5; ++i)
+			for (int j = 0; j < 5; ++j)
+				w.addCell(new TestCell(1.6 * DEFAULT_CELL_RADIUS * Vec(i, 0, j)));
+		for (int i = 0; i < 100; ++i) w.update();
+		if (nbThreads > 1) {
+			// every cell is in exactly one block
+			std::set<TestCell *> inBlocks;
+			size_t nbCells = 0;
+			for (auto &b : w.getPartition().getBlocks()) {
+				inBlocks.insert(b.cells.begin(), b.cells.end());
+				nbCells += b.cells.size();
+			}
+			REQUIRE(w.getPartition().size() == 3);
+			REQUIRE(nbCells == w.cells.size());
+			REQUIRE(inBlocks.size() == w.cells.size());
+		}
+		results.push_back(vector<Vec>());
+		for (auto &c : w.cells) results.back().push_back(c->getPosition());
+	}
+	for (size_t i = 0; i < results[0].size(); ++i) REQUIRE(results[0][i] == results[1][i]);
+	// the partition is only rebuilt when cells or connections change
+	TestWorld w;
+	w.setNbMechanicsThreads(2);
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			w.addCell(new TestCell(1.6 * DEFAULT_CELL_RADIUS * Vec(i, j, 0)));
+	for (int i = 0; i < 300; ++i) w.update();
+	size_t nbRebuilds = w.getPartition().getNbRebuilds();
+	size_t nbConnections = w.connections.size();
+	REQUIRE(nbConnections > 0);
+	for (int i = 0; i < 20; ++i) w.update();
+	REQUIRE(w.connections.size() == nbConnections);
+	REQUIRE(w.getPartition().getNbRebuilds() == nbRebuilds);
+	w.addCell(new TestCell(Vec(0, 0, 10 * DEFAULT_CELL_RADIUS)));
+	w.update();
+	REQUIRE(w.getPartition().getNbRebuilds() == nbRebuilds + 1);
+}
+
+TEST_CASE("Flat grid") {
+	std::default_random_engine rng(7);
+	std::uniform_real_distribution<double> pos(-2000, 2000), radius(5, 300);
+	vector<TestCell *> cells;
+	for (int i = 0; i < 500; ++i) {
+		cells.push_back(new TestCell(Vec(pos(rng), pos(rng), 0.2 * pos(rng))));
+		cells.back()->setRadius(radius(rng));
+	}
+	const double cellSize = 5.0 * DEFAULT_CELL_RADIUS;
+	Grid<TestCell *> grid(cellSize);
+	for (auto &c : cells) grid.insert(c);
+	FlatGrid<TestCell *> serial(cellSize), parallel(cellSize);
+	WorkStealingPool pool(3);
+	serial.build(cells);
+	parallel.build(cells, &pool);
+	REQUIRE(serial.getContent().size() == grid.getContent().size());
+	// same candidates, in the same order
+	for (auto &c : cells) {
+		vector<TestCell *> expected = grid.retrieve(c);
+		REQUIRE(serial.retrieve(c) == expected);
+		REQUIRE(parallel.retrieve(c) == expected);
+	}
+	REQUIRE(serial.retrieve(Vec(1e5, 0, 0), 10).empty());
+	serial.clear();
+	REQUIRE(serial.retrieve(cells[0]).empty());
+	for (auto &c : cells) delete c;
+}
+
+TEST_CASE("Hierarchical grid") {
+	std::default_random_engine rng(11);
+	std::uniform_real_distribution<double> pos(-1500, 1500), radius(20, 40);
+	vector<TestCell *> cells;
+	for (int i = 0; i < 600; ++i) {
+		cells.push_back(new TestCell(Vec(pos(rng), pos(rng), pos(rng))));
+		cells.back()->setRadius(i % 100 ? radius(rng) : 800.0);
+	}
+	const double cellSize = 5.0 * DEFAULT_CELL_RADIUS;
+	FlatGrid<TestCell *> flat(cellSize);
+	HierarchicalGrid<TestCell *> hierarchical(cellSize);
+	flat.build(cells);
+	hierarchical.build(cells);
+	REQUIRE(hierarchical.levelOf(40) == 0);
+	REQUIRE(hierarchical.levelOf(800) == 3);
+	REQUIRE(hierarchical.getNbLevels() == 4);
+	// big cells only fill a few buckets
+	REQUIRE(hierarchical.getNbEntries() * 3 < flat.getNbEntries());
+	size_t nbFlatCandidates = 0, nbCandidates = 0;
+	for (auto &c : cells) {
+		vector<TestCell *> candidates = hierarchical.retrieve(c);
+		nbCandidates += candidates.size();
+		nbFlatCandidates += flat.retrieve(c).size();
+		std::set<TestCell *> found(candidates.begin(), candidates.end());
+		for (auto &o : cells) {
+			double r = c->getRadius() + o->getRadius();
+			if ((c->getPosition() - o->getPosition()).sqlength() <= r * r)
+				REQUIRE(found.count(o));
+		}
+	}
+	REQUIRE(nbCandidates < nbFlatCandidates);
+	for (auto &c : cells) delete c;
+
+	TestWorld w;
+	w.setCellGridCellSize(100);
+	w.addCell(new TestCell(Vec::zero()));
+	w.cells[0]->setRadius(400);
+	w.addCell(new TestCell(Vec(420, 0, 0)));
+	w.update();
+	REQUIRE(w.getCellGrid().getNbLevels() == 4);
+	REQUIRE(w.connections.size() == 1);
+}
+
+TEST_CASE("Morton reordering") {
+	TestWorld w;
+	w.setReorderPeriod(5);
+	// added in a scattered order
+	const double d = 1.8 * DEFAULT_CELL_RADIUS;
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			w.addCell(new TestCell(d * Vec((i * 3) % 4, 0, (j * 3) % 4)));
+	std::set<TestCell *> before(w.cells.begin(), w.cells.end());
+	for (int i = 0; i < 5; ++i) w.update();
+	REQUIRE(std::set<TestCell *>(w.cells.begin(), w.cells.end()) == before);
+	MortonEncoder encode = MortonEncoder::fromPositions(w.cells.begin(), w.cells.end());
+	for (size_t i = 1; i < w.cells.size(); ++i)
+		REQUIRE(encode(w.cells[i - 1]->getPosition()) <= encode(w.cells[i]->getPosition()));
+	for (int i = 0; i < 20; ++i) w.update();
+	REQUIRE(w.cells.size() == 16);
+}
+
+// remembers the thread that built it
+class BuiltCell : public ConnectableCell<BuiltCell> {
+public:
+	std::thread::id builder = std::this_thread::get_id();
+	BuiltCell(const Vec &v) : ConnectableCell<BuiltCell>(v) {}
+	BuiltCell(const BuiltCell &c, const Vec &translation)
+	    : ConnectableCell<BuiltCell>(c, translation) {}
+	double getAdhesionWith(const BuiltCell *) { return 0.5; }
+	BuiltCell *updateBehavior(double) { return nullptr; }
+};
+
+TEST_CASE("Bulk cell insertion") {
+	const double d = 1.6 * DEFAULT_CELL_RADIUS;
+	vector<Vec> positions;
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			for (int k = 0; k < 3; ++k) positions.push_back(d * Vec(i, j, k));
+	for (size_t nbThreads : {1, 3}) {
+		TestWorld w;
+		w.setNbMechanicsThreads(nbThreads);
+		w.addCell(new TestCell(Vec(0, -d, 0)));
+		TestCell *first = w.addCells(positions);
+		REQUIRE(w.cells.size() == 28);
+		REQUIRE(w.cells[1] == first);
+		// face neighbours only, the cell added before is connected by the next update
+		REQUIRE(w.connections.size() == 54);
+		w.update();
+		REQUIRE(w.connections.size() == 55);
+		// bulk cells are destroyed in place
+		for (int i = 0; i < 27; i += 2) first[i].die();
+		w.update();
+		REQUIRE(w.cells.size() == 14);
+		for (auto &c : w.cells) c->die();
+		w.update();
+		REQUIRE(w.cells.empty());
+		REQUIRE(w.connections.empty());
+	}
+	TestWorld w;
+	const Vec p(DEFAULT_CELL_RADIUS, 0, 0);
+	TestCell *first = w.addCells({Vec::zero(), p}, {10.0, 20.0});
+	REQUIRE(first[1].getRadius() == 20.0);
+	REQUIRE(w.connections.empty());
+	// each partition block holds the cells built by its worker
+	BasicWorld<BuiltCell, Euler> bw;
+	bw.setNbMechanicsThreads(3);
+	bw.addCells(hexagonalClosePacking(Vec::zero(), Vec(8 * d), d));
+	bw.update();
+	std::set<std::thread::id> builders;
+	for (auto &b : bw.getPartition().getBlocks()) {
+		REQUIRE(!b.cells.empty());
+		for (auto &c : b.cells) REQUIRE(c->builder == b.cells[0]->builder);
+		builders.insert(b.cells[0]->builder);
+	}
+	REQUIRE(builders.size() == 3);
+	REQUIRE(builders.count(std::this_thread::get_id()) == 0);
+}
+
+TEST_CASE("Initial configuration generators") {
+	const double R = DEFAULT_CELL_RADIUS, s = 1.8 * R;
+	auto minDistance = [](const vector<Vec> &p) {
+		double res = std::numeric_limits<double>::infinity();
+		for (size_t i = 0; i < p.size(); ++i)
+			for (size_t j = i + 1; j < p.size(); ++j)
+				res = std::min<double>(res, (p[i] - p[j]).length());
+		return res;
+	};
+	vector<Vec> hcp = hexagonalClosePacking(Vec::zero(), Vec(6 * R), s);
+	REQUIRE(hcp.size() > 20);
+	REQUIRE(doubleEq(minDistance(hcp) / s, 1.0));
+	{
+		// interior cells of a close packing have 12 neighbours
+		TestWorld w;
+		w.addCells(hcp);
+		int maxConnections = 0;
+		for (auto &c : w.cells)
+			maxConnections = std::max(maxConnections, c->getNbConnections());
+		REQUIRE(maxConnections == 12);
+	}
+	vector<Vec> jittered = jitteredLattice(Vec::zero(), Vec(6 * R), s, 0.1);
+	REQUIRE(jittered.size() == 64);
+	REQUIRE(minDistance(jittered) >= 0.8 * s);
+
+	// 10R wide cube
+	std::stringstream obj;
+	obj << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+	    << "f 1 3 2\nf 1 4 3\nf 5 6 7\nf 5 7 8\nf 1 2 6\nf 1 6 5\n"
+	    << "f 4 7 3\nf 4 8 7\nf 1 5 8\nf 1 8 4\nf 2 3 7\nf 2 7 6\n";
+	Model cube(std::make_shared<const ModelData>(obj));
+	cube.scale(Vec(10 * R));
+	REQUIRE(isInsideModel(cube, Vec(5 * R)));
+	REQUIRE(!isInsideModel(cube, Vec(11 * R)));
+	REQUIRE(doubleEq(distanceToModel(cube, Vec(5 * R, 5 * R, 2 * R)), 2 * R));
+	vector<Vec> poisson = poissonDiskInModel(cube, s, R);
+	REQUIRE(poisson.size() > 50);
+	REQUIRE(minDistance(poisson) >= s);
+	for (auto &p : poisson) {
+		REQUIRE(isInsideModel(cube, p));
+		REQUIRE(distanceToModel(cube, p) >= R);
+	}
+	vector<Vec> layer = surfaceMonolayer(cube, s, 0);
+	REQUIRE(layer.size() > 50);
+	REQUIRE(minDistance(layer) >= s);
+	for (auto &p : layer) REQUIRE(distanceToModel(cube, p) < 1e-3);
+}
+
+TEST_CASE("Cell - model contacts") {
+	const double R = DEFAULT_CELL_RADIUS;
+	std::stringstream obj;
+	obj << "v -1 0 -1\nv 1 0 -1\nv 1 0 1\nv -1 0 1\nf 1 3 2\nf 1 4 3\n";
+	Model plane(std::make_shared<const ModelData>(obj));
+	plane.scale(Vec(10 * R));
+	TestWorld w;
+	w.addModel("plane", plane);
+	w.setG(Vec(0, -20, 0));
+	w.addCell(new TestCell(Vec(0, 0.9 * R, 0)));
+	w.addCell(new TestCell(Vec(3 * R, 0.9 * R, 0)));
+	for (int i = 0; i < 200; ++i) w.update();
+	for (auto &c : w.cells) {
+		REQUIRE(c->getPosition().y > 0);
+		REQUIRE(c->getPosition().y < R);
+		// contacts are stored by value in the world, cells point to them
+		REQUIRE(c->getRWModelConnections().size() == 1);
+		auto &stored = w.cellModelConnections.at(&w.models.at("plane")).at(c);
+		REQUIRE(c->getRWModelConnections()[0] == &stored[0]);
+		REQUIRE(stored[0].cell == c);
+	}
+	// replacing a model drops the contacts of the old instance
+	w.addModel("plane", plane);
+	REQUIRE(w.cellModelConnections.empty());
+	for (auto &c : w.cells) REQUIRE(c->getRWModelConnections().empty());
+	for (int i = 0; i < 20; ++i) w.update();
+	for (auto &m : w.cellModelConnections) REQUIRE(m.first == &w.models.at("plane"));
+	for (auto &c : w.cells) REQUIRE(c->getRWModelConnections().size() == 1);
+	w.removeModel("plane");
+	REQUIRE(w.cellModelConnections.empty());
+	for (auto &c : w.cells) REQUIRE(c->getRWModelConnections().empty());
+}
+
+struct ContactWorld : public TestWorld {
+	using TestWorld::lastModelQueryPosition;
+};
+
+TEST_CASE("Cell - model contact tracking") {
+	const double R = DEFAULT_CELL_RADIUS;
+	std::stringstream obj;
+	// 2 faces sharing the x = z diagonal: face 0 where x > z, face 1 where x < z
+	obj << "v -1 0 -1\nv 1 0 -1\nv 1 0 1\nv -1 0 1\nf 1 3 2\nf 1 4 3\n";
+	auto plane = std::make_shared<const ModelData>(obj);
+	auto contactWith = [](ContactWorld &w, TestCell *c) {
+		return w.cellModelConnections.at(&w.models.at("plane")).at(c);
+	};
+	auto moveTo = [](TestCell *c, const Vec &p) {
+		c->setPrevposition(c->getPosition());
+		c->setPosition(p);
+	};
+	auto broadPhase = [&](const Vec &p) {
+		ContactWorld w;
+		w.addModel("plane", plane);
+		w.models.at("plane").scale(Vec(10 * R));
+		w.addCell(new TestCell(p));
+		w.updateModelGrid();
+		w.checkForCellModellCollisions();
+		return contactWith(w, w.cells[0]);
+	};
+	ContactWorld w;
+	w.addModel("plane", plane);
+	w.models.at("plane").scale(Vec(10 * R));
+	const Vec p0(0.3 * R, 0.9 * R, 0);
+	w.addCell(new TestCell(p0));
+	TestCell *c = w.cells[0];
+	w.updateModelGrid();
+	w.checkForCellModellCollisions();
+	REQUIRE(contactWith(w, c).size() == 1);
+	REQUIRE(contactWith(w, c)[0].getFace() == 0);
+	REQUIRE(w.lastModelQueryPosition.at(c) == p0);
+
+	// small move across the edge: the contact walks to the adjacent face
+	const Vec p1(0, 0.9 * R, 0.2 * R);
+	REQUIRE((p1 - p0).length() < w.getContactRequeryRatio() * R);
+	moveTo(c, p1);
+	w.checkForCellModellCollisions();
+	REQUIRE(w.lastModelQueryPosition.at(c) == p0);
+	auto tracked = contactWith(w, c), expected = broadPhase(p1);
+	REQUIRE(tracked.size() == 1);
+	REQUIRE(expected.size() == 1);
+	REQUIRE(tracked[0].getFace() == 1);
+	REQUIRE(tracked[0].getFace() == expected[0].getFace());
+	REQUIRE((tracked[0].bouncePoint.position - expected[0].bouncePoint.position).length() <
+	        EPSILON);
+
+	// larger moves go through the model grid again
+	const Vec p2(-0.6 * R, 0.9 * R, 0.2 * R);
+	REQUIRE((p2 - p0).length() > w.getContactRequeryRatio() * R);
+	moveTo(c, p2);
+	w.checkForCellModellCollisions();
+	REQUIRE(w.lastModelQueryPosition.at(c) == p2);
+	REQUIRE(contactWith(w, c).size() == 1);
+	REQUIRE(contactWith(w, c)[0].getFace() == 1);
+}
+
+template <ConnectionKind K> class LeanCell : public ConnectableCell<LeanCell<K>, K> {
+	using Base = ConnectableCell<LeanCell<K>, K>;
+
+public:
+	LeanCell(const Vec &v) : Base(v) {}
+	LeanCell(const LeanCell &c, const Vec &translation) : Base(c, translation) {}
+	double getAdhesionWith(const LeanCell *) { return 0.5; }
+	LeanCell *updateBehavior(double) { return nullptr; }
+};
+
+TEST_CASE("Lean connections") {
+	using SpringCell = LeanCell<ConnectionKind::Spring>;
+	using FlexCell = LeanCell<ConnectionKind::SpringFlex>;
+	REQUIRE(sizeof(SpringCell::ConnectionType) < sizeof(FlexCell::ConnectionType));
+	REQUIRE(sizeof(FlexCell::ConnectionType) < sizeof(TestCell::ConnectionType));
+	auto init = [](vector<Vec> &positions) {
+		for (int i = 0; i < 4; ++i)
+			for (int j = 0; j < 4; ++j)
+				positions.push_back(1.7 * DEFAULT_CELL_RADIUS * Vec(i, j, 0.1 * (i + j)));
+	};
+	vector<Vec> positions;
+	init(positions);
+	TestWorld full;
+	BasicWorld<FlexCell, Euler> flex;
+	BasicWorld<SpringCell, Euler> spring;
+	for (auto &p : positions) {
+		full.addCell(new TestCell(p));
+		flex.addCell(new FlexCell(p));
+		spring.addCell(new SpringCell(p));
+	}
+	full.setG(Vec(0, -20, 0));
+	flex.setG(Vec(0, -20, 0));
+	spring.setG(Vec(0, -20, 0));
+	for (int i = 0; i < 100; ++i) {
+		full.update();
+		flex.update();
+		spring.update();
+	}
+	// torsion joints are disabled by default: spring + flex connections behave the same
+	REQUIRE(flex.connections.size() == full.connections.size());
+	REQUIRE(spring.connections.size() == full.connections.size());
+	for (size_t i = 0; i < full.cells.size(); ++i) {
+		REQUIRE(flex.cells[i]->getPosition() == full.cells[i]->getPosition());
+		REQUIRE(flex.cells[i]->getOrientation().X == full.cells[i]->getOrientation().X);
+		REQUIRE(flex.cells[i]->getOrientation().Y == full.cells[i]->getOrientation().Y);
+	}
+}
+
+// runs the same world with both force backends and returns the largest distance between
+// their cells
+template <typename World> double compareBackends(std::function<void(World &)> run) {
+	vector<vector<Vec>> results;
+	for (auto backend : {ForceBackend::PerConnection, ForceBackend::Batch}) {
+		World w;
+		w.setForceBackend(backend);
+		run(w);
+		REQUIRE(w.connections.size() > 0);
+		results.push_back(vector<Vec>());
+		for (auto &c : w.cells) results.back().push_back(c->getPosition());
+	}
+	REQUIRE(results[0].size() == results[1].size());
+	double d = 0;
+	for (size_t i = 0; i < results[0].size(); ++i)
+		d = std::max<double>(d, (results[0][i] - results[1][i]).length());
+	return d;
+}
+
+TEST_CASE("Batch spring forces") {
+	// the batch kernel sums the forces in another order: both backends agree up to rounding
+	const double tol = 1e3 * EPSILON * DEFAULT_CELL_RADIUS;
+	const double R = DEFAULT_CELL_RADIUS;
+	// a falling cluster, with a pair compressed under the minimum length of its spring
+	REQUIRE(compareBackends<TestWorld>([R](TestWorld &w) {
+		        w.setG(Vec(0, -20, 0));
+		        for (int i = 0; i < 5; ++i)
+			        for (int j = 0; j < 5; ++j)
+				        w.addCell(new TestCell(1.6 * R * Vec(i, 0.1 * (i + j), j)));
+		        w.addCell(new TestCell(Vec(0, 3 * R, 0)));
+		        w.addCell(new TestCell(Vec(0.2 * R, 3 * R, 0)));
+		        for (int i = 0; i < 50; ++i) w.update();
+		      }) < tol);
+	// connections created and deleted by divisions
+	using DivWorld = BasicWorld<DividingCell, Euler>;
+	REQUIRE(compareBackends<DivWorld>([](DivWorld &w) {
+		        w.setNbBehaviorThreads(2); // seeds the divisions from the frame number
+		        w.addCell(new DividingCell(Vec::zero()));
+		        for (int i = 0; i < 35; ++i) w.update();
+		        REQUIRE(w.cells.size() == 8);
+		      }) < tol);
+	// connections between sleeping cells are skipped
+	REQUIRE(compareBackends<TestWorld>([R](TestWorld &w) {
+		        w.enableSleeping(1e-3, 1e-2, 20);
+		        for (int i = 0; i < 4; ++i) w.addCell(new TestCell(Vec(i * 1.5 * R, 0, 0)));
+		        for (int i = 0; i < 3000; ++i) w.update();
+		        REQUIRE(w.getNbSleepingCells() == 4);
+		      }) < tol);
+}
+
+#ifdef MECACELL_SOCKET_TRANSPORT
+TEST_CASE("Distributed world") {
+	const int nbRanks = 3, nbCells = 30;
+	auto transports = SocketTransport::createLocal(nbRanks);
+	vector<size_t> initial(nbRanks), owned(nbRanks), ghosts(nbRanks);
+	vector<int> misplaced(nbRanks, 0);
+	vector<std::thread> threads;
+	for (int r = 0; r < nbRanks; ++r) {
+		threads.emplace_back([&, r]() {
+			const double R = DEFAULT_CELL_RADIUS;
+			DistributedWorld<TestCell, Euler> w(transports[r], -16 * R, 16 * R);
+			w.setG(Vec(50, 0, 0));
+			for (int i = 0; i < nbCells; ++i)
+				w.addCell(new TestCell(Vec((i - nbCells / 2) * 1.6 * R, 0, 0)));
+			initial[r] = w.getNbOwnedCells();
+			for (int i = 0; i < 200; ++i) {
+				w.update();
+				ghosts[r] = std::max(ghosts[r], w.getNbGhosts());
+			}
+			owned[r] = w.getNbOwnedCells();
+			for (auto &c : w.cells)
+				if (!w.isGhost(c) && !w.isLocal(c->getPosition())) ++misplaced[r];
+		});
+	}
+	for (auto &t : threads) t.join();
+	REQUIRE(initial[0] + initial[1] + initial[2] == nbCells);
+	REQUIRE(owned[0] + owned[1] + owned[2] == nbCells);
+	REQUIRE(owned[2] > initial[2]);
+	for (int r = 0; r < nbRanks; ++r) {
+		REQUIRE(ghosts[r] > 0);
+		REQUIRE(misplaced[r] <= 1); // cells may cross a boundary during the last step
+	}
+	// adaptive time steps would desynchronize the ranks
+	auto single = SocketTransport::createLocal(1);
+	DistributedWorld<TestCell, Euler> w(single[0], 0, 1);
+	TestWorld &base = w;
+	base.enableAdaptiveDt(0.001, 0.1);
+	REQUIRE_THROWS_AS(w.update(), const std::runtime_error &);
+}
+#endif